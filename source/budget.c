@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "../thirdparty/SDL2/SDL.h"
+
+typedef enum {
+    BUDGET_PACKETS,   /* demuxed packets waiting for a decoder */
+    BUDGET_FRAMES,    /* decoder frame pools */
+    BUDGET_AUDIO,     /* audio output ring */
+    BUDGET_VIDEO,     /* video and subtitle textures, conversion buffer */
+    BUDGET_SUBTITLES, /* libass caches, counted at their configured limit */
+    BUDGET_UI,        /* text cache, glyph atlas, retained overlay */
+    BUDGET_COUNT
+} BudgetSubsystem;
+
+static const char* budget_names[BUDGET_COUNT] = {
+    "packets", "frames", "audio", "video", "subtitles", "ui",
+};
+
+/* One memory budget shared by every queue, cache and texture. Subsystems
+ * report what they hold; the ones that can shrink (packet queues, side
+ * audio, the text cache) check budget_over() and back off or evict. Frame
+ * pools may be touched from decoder threads, hence the spinlock. */
+static SDL_SpinLock budget_lock = 0;
+static int64_t budget_limit = 0; /* 0 is unlimited */
+static int64_t budget_used[BUDGET_COUNT];
+static int64_t budget_sum = 0;  /* of budget_used */
+static int64_t budget_peak = 0; /* highest budget_sum, for the stats overlay */
+
+static void budget_add(BudgetSubsystem sub, int64_t delta) {
+    SDL_AtomicLock(&budget_lock);
+    budget_used[sub] += delta;
+    budget_sum += delta;
+    if (budget_sum > budget_peak) budget_peak = budget_sum;
+    SDL_AtomicUnlock(&budget_lock);
+}
+
+static void budget_set(BudgetSubsystem sub, int64_t bytes) {
+    SDL_AtomicLock(&budget_lock);
+    budget_sum += bytes - budget_used[sub];
+    budget_used[sub] = bytes;
+    if (budget_sum > budget_peak) budget_peak = budget_sum;
+    SDL_AtomicUnlock(&budget_lock);
+}
+
+static int64_t budget_get(BudgetSubsystem sub) {
+    SDL_AtomicLock(&budget_lock);
+    int64_t used = budget_used[sub];
+    SDL_AtomicUnlock(&budget_lock);
+    return used;
+}
+
+static int64_t budget_total(void) {
+    SDL_AtomicLock(&budget_lock);
+    int64_t total = budget_sum;
+    SDL_AtomicUnlock(&budget_lock);
+    return total;
+}
+
+static int64_t budget_get_peak(void) {
+    SDL_AtomicLock(&budget_lock);
+    int64_t peak = budget_peak;
+    SDL_AtomicUnlock(&budget_lock);
+    return peak;
+}
+
+static int budget_over(void) {
+    return budget_limit > 0 && budget_total() > budget_limit;
+}
+
+/* Share of the budget a cache may reserve, or `fallback` when unlimited. */
+static int64_t budget_share(double fraction, int64_t fallback) {
+    if (budget_limit <= 0) return fallback;
+    int64_t share = (int64_t)((double)budget_limit * fraction);
+    return share < fallback ? share : fallback;
+}
+
+/* Accepts plain bytes or a K/M/G suffix, e.g. "768M" or "1G". */
+static int64_t budget_parse_size(const char* s) {
+    if (!s) return -1;
+    char* end = NULL;
+    double v = strtod(s, &end);
+    if (end == s || v <= 0.0) return -1;
+    switch (toupper((unsigned char)*end)) {
+        case 'G': v *= 1024.0; /* fallthrough */
+        case 'M': v *= 1024.0; /* fallthrough */
+        case 'K': v *= 1024.0; end++; break;
+        case '\0': break;
+        default: return -1;
+    }
+    if (*end == 'B' || *end == 'b') end++;
+    if (*end != '\0') return -1;
+    return (int64_t)v;
+}
+
+/* The configured limit; usage per subsystem is only meaningful once a file
+ * plays, and is shown in the stats overlay. */
+static void budget_report(FILE* out) {
+    if (budget_limit > 0) fprintf(out, "Memory budget: %.1f MB\n", (double)budget_limit / (1024.0 * 1024.0));
+    else fprintf(out, "Memory budget: unlimited\n");
+}
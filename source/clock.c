@@ -0,0 +1,68 @@
+#include <stdint.h>
+#include "../thirdparty/SDL2/SDL.h"
+
+/* Playback clock on the performance counter. Media time is kept as a base
+ * time plus the scaled wall time elapsed since the last rebase; speed
+ * changes, pauses and seeks rebase at a single sampled instant, so nothing
+ * accumulates drift. The spinlock makes it safe to read from any thread. */
+typedef struct {
+    SDL_SpinLock lock;
+    int64_t base_ns;
+    double base_time;
+    double speed;
+    int paused;
+} AmpClock;
+
+static int64_t amp_clock_now_ns(void) {
+    static Uint64 freq = 0;
+    if (!freq) freq = SDL_GetPerformanceFrequency();
+    Uint64 c = SDL_GetPerformanceCounter();
+    return (int64_t)((c / freq) * 1000000000ull + (c % freq) * 1000000000ull / freq);
+}
+
+static double amp_clock_at(const AmpClock* c, int64_t now_ns) {
+    if (c->paused) return c->base_time;
+    return c->base_time + (double)(now_ns - c->base_ns) * 1e-9 * c->speed;
+}
+
+static void amp_clock_init(AmpClock* c, double t) {
+    c->lock = 0;
+    c->base_ns = amp_clock_now_ns();
+    c->base_time = t;
+    c->speed = 1.0;
+    c->paused = 0;
+}
+
+static double amp_clock_get(AmpClock* c) {
+    SDL_AtomicLock(&c->lock);
+    double t = amp_clock_at(c, amp_clock_now_ns());
+    SDL_AtomicUnlock(&c->lock);
+    return t;
+}
+
+static void amp_clock_set(AmpClock* c, double t) {
+    SDL_AtomicLock(&c->lock);
+    c->base_ns = amp_clock_now_ns();
+    c->base_time = t;
+    SDL_AtomicUnlock(&c->lock);
+}
+
+static void amp_clock_set_speed(AmpClock* c, double speed) {
+    SDL_AtomicLock(&c->lock);
+    int64_t now = amp_clock_now_ns();
+    c->base_time = amp_clock_at(c, now);
+    c->base_ns = now;
+    c->speed = speed;
+    SDL_AtomicUnlock(&c->lock);
+}
+
+static void amp_clock_set_paused(AmpClock* c, int paused) {
+    SDL_AtomicLock(&c->lock);
+    if (!paused != !c->paused) {
+        int64_t now = amp_clock_now_ns();
+        c->base_time = amp_clock_at(c, now);
+        c->base_ns = now;
+        c->paused = paused ? 1 : 0;
+    }
+    SDL_AtomicUnlock(&c->lock);
+}
@@ -20,6 +20,9 @@
 #define SAVE_FILE 1
 #define SAVE_FILE_PATH "amp_save.dat"
 #define HASH_SIZE 256
+#define SAVE_KEY_INDEX_MAX 65536 /* keyframes remembered per file, 16 bytes each */
+#define STORYBOARD_DIR "amp_storyboards" /* timeline thumbnails, next to SAVE_FILE_PATH */
+#define STORYBOARD_MAX_BYTES ((int64_t)256 * 1024 * 1024) /* across all files, least recently used evicted */
 
 /* Menu dimensions */
 #define MENU_DROPDOWN_ITEM_HEIGHT 28
@@ -29,6 +32,19 @@
 #define MENU_DROPDOWN_TEXT_PADDING_Y 2
 #define MENU_MAX_VISIBLE_ITEMS 10
 
+/* Main loop */
+#define LOOP_IDLE_WAIT_MS 500
+#define PRESENT_MAX_DROPS 8 /* late frames skipped per loop iteration before one is shown anyway */
+#define STATS_MAX_LINES 24
+
+/* Decoding */
+#define FRAME_POOL_HUGE_PAGES 1 /* map 4K-sized frame buffers onto transparent huge pages (Linux) */
+
+/* Text rendering */
+#define TEXT_CACHE_ENTRIES 128
+#define TEXT_ATLAS_SIZE 1024
+#define TEXT_ATLAS_MAX_GLYPHS 1024 /* power of two */
+
 /* Timeline dimensions */
 #define TIMELINE_HEIGHT 6
 #define TIMELINE_HITBOX_PADDING 12
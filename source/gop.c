@@ -0,0 +1,59 @@
+#include <stdint.h>
+#include <string.h>
+#include "../thirdparty/libavutil/frame.h"
+#include "../thirdparty/libavutil/imgutils.h"
+
+#define GOP_CACHE_MAX_FRAMES 128
+#define GOP_CACHE_MAX_BYTES ((int64_t)256 * 1024 * 1024)
+#define GOP_CACHE_BUDGET_SHARE 0.25
+
+/* Decoded frames of one stretch of video in presentation order, referenced
+ * rather than copied, so they stay in the decoder's frame pool (and in its
+ * BUDGET_FRAMES accounting). When full, the oldest frame goes first. */
+typedef struct {
+    AVFrame* frames[GOP_CACHE_MAX_FRAMES];
+    double times[GOP_CACHE_MAX_FRAMES];
+    int count;
+    int64_t bytes;
+} GopCache;
+
+static int64_t gop_frame_bytes(const AVFrame* f) {
+    int size = av_image_get_buffer_size(f->format, f->width, f->height, 1);
+    return size > 0 ? size : 0;
+}
+
+static void gop_cache_clear(GopCache* gc) {
+    for (int i = 0; i < gc->count; i++) av_frame_free(&gc->frames[i]);
+    gc->count = 0;
+    gc->bytes = 0;
+}
+
+static void gop_cache_drop_oldest(GopCache* gc) {
+    if (gc->count <= 0) return;
+    gc->bytes -= gop_frame_bytes(gc->frames[0]);
+    av_frame_free(&gc->frames[0]);
+    gc->count--;
+    memmove(gc->frames, gc->frames + 1, (size_t)gc->count * sizeof(gc->frames[0]));
+    memmove(gc->times, gc->times + 1, (size_t)gc->count * sizeof(gc->times[0]));
+}
+
+static int gop_cache_push(GopCache* gc, const AVFrame* src, double t, int64_t max_bytes) {
+    AVFrame* f = av_frame_clone(src);
+    if (!f) return 0;
+    int64_t size = gop_frame_bytes(f);
+    while (gc->count > 0 && (gc->count == GOP_CACHE_MAX_FRAMES || gc->bytes + size > max_bytes)) {
+        gop_cache_drop_oldest(gc);
+    }
+    gc->frames[gc->count] = f;
+    gc->times[gc->count] = t;
+    gc->count++;
+    gc->bytes += size;
+    return 1;
+}
+
+/* Last frame presented at or before `t`, or -1. */
+static int gop_cache_find(const GopCache* gc, double t) {
+    int found = -1;
+    for (int i = 0; i < gc->count && gc->times[i] <= t; i++) found = i;
+    return found;
+}
@@ -0,0 +1,187 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../thirdparty/nob.h"
+#include "../thirdparty/SDL2/SDL.h"
+#include "../thirdparty/libavformat/avformat.h"
+
+#define KEY_INDEX_PAUSE_POLL_MS 100
+
+typedef struct {
+    int64_t ts;  /* in the stream's time base */
+    int64_t pos; /* byte position the demuxer seeks to for this keyframe */
+} KeyframeEntry;
+
+typedef struct {
+    KeyframeEntry* entries;
+    int64_t count;
+    int64_t capacity;
+    int32_t stream_index;
+    AVRational time_base;
+    int scanned; /* read from packets because the container's own table was incomplete */
+} KeyframeIndex;
+
+static void key_index_free(KeyframeIndex* ki) {
+    free(ki->entries);
+    memset(ki, 0, sizeof(*ki));
+}
+
+static int key_index_push(KeyframeIndex* ki, int64_t ts, int64_t pos) {
+    if (ki->count > 0 && ts <= ki->entries[ki->count - 1].ts) return 1;
+    if (ki->count == ki->capacity) {
+        int64_t cap = ki->capacity ? ki->capacity * 2 : 1024;
+        KeyframeEntry* e = (KeyframeEntry*)realloc(ki->entries, (size_t)cap * sizeof(KeyframeEntry));
+        if (!e) return 0;
+        ki->entries = e;
+        ki->capacity = cap;
+    }
+    ki->entries[ki->count].ts = ts;
+    ki->entries[ki->count].pos = pos;
+    ki->count++;
+    return 1;
+}
+
+static int key_index_copy(KeyframeIndex* dst, const KeyframeIndex* src) {
+    key_index_free(dst);
+    if (src->count <= 0) return 1;
+    dst->entries = (KeyframeEntry*)malloc((size_t)src->count * sizeof(KeyframeEntry));
+    if (!dst->entries) return 0;
+    memcpy(dst->entries, src->entries, (size_t)src->count * sizeof(KeyframeEntry));
+    dst->count = dst->capacity = src->count;
+    dst->stream_index = src->stream_index;
+    dst->time_base = src->time_base;
+    dst->scanned = src->scanned;
+    return 1;
+}
+
+/* Last keyframe at or before `ts`, or -1. */
+static int64_t key_index_find(const KeyframeIndex* ki, int64_t ts) {
+    int64_t lo = 0, hi = ki->count - 1, found = -1;
+    while (lo <= hi) {
+        int64_t mid = lo + (hi - lo) / 2;
+        if (ki->entries[mid].ts <= ts) { found = mid; lo = mid + 1; }
+        else hi = mid - 1;
+    }
+    return found;
+}
+
+/* Takes the demuxer's own keyframe entries, which carry the positions its
+ * seek code expects (cluster starts in Matroska, samples in MP4). */
+static void key_index_from_stream(KeyframeIndex* ki, AVStream* st) {
+    int n = avformat_index_get_entries_count(st);
+    for (int i = 0; i < n; i++) {
+        const AVIndexEntry* e = avformat_index_get_entry(st, i);
+        if (e && (e->flags & AVINDEX_KEYFRAME)) key_index_push(ki, e->timestamp, e->pos);
+    }
+}
+
+/* True when the demuxer's index already spans the stream, as with MP4 sample
+ * tables or Matroska files whose cues are read up front. */
+static int key_index_stream_complete(AVFormatContext* fmt, AVStream* st) {
+    int n = avformat_index_get_entries_count(st);
+    if (n < 2) return 0;
+    const AVIndexEntry* last = avformat_index_get_entry(st, n - 1);
+    int64_t duration = st->duration;
+    if (duration == AV_NOPTS_VALUE && fmt->duration != AV_NOPTS_VALUE)
+        duration = av_rescale_q(fmt->duration, AV_TIME_BASE_Q, st->time_base);
+    if (duration == AV_NOPTS_VALUE || duration <= 0) return 0;
+    int64_t start = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+    return last && last->timestamp - start >= duration * 9 / 10;
+}
+
+/* Background scan of one video stream on a private demuxer. Other streams are
+ * discarded so their payloads are skipped where the container allows. */
+typedef struct {
+    SDL_Thread* thread;
+    char* path;
+    int stream_index;
+    SDL_atomic_t cancel;
+    SDL_atomic_t paused;   /* window hidden: hold the scan where it is */
+    SDL_atomic_t state;    /* 0 running, 1 done, -1 failed */
+    SDL_atomic_t progress; /* per mille of the file read */
+    KeyframeIndex result;
+} KeyIndexBuilder;
+
+static int SDLCALL key_index_build(void* userdata) {
+    KeyIndexBuilder* b = (KeyIndexBuilder*)userdata;
+    AVFormatContext* fmt = NULL;
+    if (avformat_open_input(&fmt, b->path, NULL, NULL) != 0 || b->stream_index >= (int)fmt->nb_streams) {
+        if (fmt) avformat_close_input(&fmt);
+        SDL_AtomicSet(&b->state, -1);
+        return 0;
+    }
+    AVStream* st = fmt->streams[b->stream_index];
+    b->result.stream_index = b->stream_index;
+    b->result.time_base = st->time_base;
+
+    if (key_index_stream_complete(fmt, st)) {
+        key_index_from_stream(&b->result, st);
+        avformat_close_input(&fmt);
+        SDL_AtomicSet(&b->progress, 1000);
+        SDL_AtomicSet(&b->state, 1);
+        return 0;
+    }
+
+    for (unsigned i = 0; i < fmt->nb_streams; i++) {
+        if ((int)i != b->stream_index) fmt->streams[i]->discard = AVDISCARD_ALL;
+    }
+    int64_t size = fmt->pb ? avio_size(fmt->pb) : 0;
+    KeyframeIndex from_packets = { 0 };
+    AVPacket* pkt = av_packet_alloc();
+    while (pkt && !SDL_AtomicGet(&b->cancel)) {
+        if (SDL_AtomicGet(&b->paused)) {
+            SDL_Delay(KEY_INDEX_PAUSE_POLL_MS);
+            continue;
+        }
+        if (av_read_frame(fmt, pkt) < 0) break;
+        if (pkt->stream_index == b->stream_index && (pkt->flags & AV_PKT_FLAG_KEY)) {
+            int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+            if (ts != AV_NOPTS_VALUE && pkt->pos >= 0) key_index_push(&from_packets, ts, pkt->pos);
+        }
+        if (size > 0 && pkt->pos >= 0) SDL_AtomicSet(&b->progress, (int)(pkt->pos * 1000 / size));
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+
+    int cancelled = SDL_AtomicGet(&b->cancel);
+    if (!cancelled) {
+        key_index_from_stream(&b->result, st);
+        if (b->result.count < from_packets.count) {
+            key_index_free(&b->result);
+            b->result = from_packets;
+            b->result.stream_index = b->stream_index;
+            b->result.time_base = st->time_base;
+            from_packets.entries = NULL;
+        }
+        b->result.scanned = 1;
+    }
+    key_index_free(&from_packets);
+    avformat_close_input(&fmt);
+    SDL_AtomicSet(&b->progress, 1000);
+    SDL_AtomicSet(&b->state, cancelled ? -1 : 1);
+    return 0;
+}
+
+static KeyIndexBuilder* key_index_builder_start(const char* path, int stream_index) {
+    KeyIndexBuilder* b = (KeyIndexBuilder*)calloc(1, sizeof(KeyIndexBuilder));
+    if (!b) return NULL;
+    b->path = strdup(path);
+    b->stream_index = stream_index;
+    b->thread = SDL_CreateThread(key_index_build, "amp-keyindex", b);
+    if (!b->thread) {
+        nob_log(NOB_WARNING, "Failed to start keyframe indexer: %s", SDL_GetError());
+        free(b->path);
+        free(b);
+        return NULL;
+    }
+    return b;
+}
+
+static void key_index_builder_free(KeyIndexBuilder* b) {
+    if (!b) return;
+    SDL_AtomicSet(&b->cancel, 1);
+    SDL_WaitThread(b->thread, NULL);
+    key_index_free(&b->result);
+    free(b->path);
+    free(b);
+}
@@ -0,0 +1,155 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../thirdparty/libavcodec/packet.h"
+#include "../thirdparty/libavutil/frame.h"
+
+#define LOOP_MIN_SEC 0.2
+#define LOOP_CACHE_MAX_BYTES ((int64_t)1024 * 1024 * 1024)
+#define LOOP_CACHE_BUDGET_SHARE 0.5
+#define LOOP_PCM_CHUNK 1024 /* output frames written per replay step */
+
+/* What one stream of an A-B loop is doing. The first pass records; after
+ * that each stream replays from memory on its own, or the loop falls back
+ * to an exact seek back to A on every pass. */
+typedef enum {
+    LOOP_OFF,
+    LOOP_RECORD,
+    LOOP_FRAMES,  /* video: decoded frames */
+    LOOP_PACKETS, /* video: compressed packets from the keyframe before A */
+    LOOP_PCM,     /* audio: output samples */
+    LOOP_SEEK,
+} LoopMode;
+
+static const char* loop_mode_names[] = { "off", "recording", "frames", "packets", "pcm", "seeking" };
+
+/* Contents of one loop pass. Frames are referenced rather than copied, like
+ * GopCache; packets are references too. The PCM is interleaved output
+ * format, starting exactly at A. */
+typedef struct {
+    AVFrame** frames;
+    double* times;
+    int frame_count;
+    int frame_cap;
+    int64_t frame_bytes;
+
+    AVPacket* packets;
+    int packet_count;
+    int packet_cap;
+    int64_t packet_bytes;
+
+    float* pcm;
+    int64_t pcm_frames;
+    int64_t pcm_cap;
+    int channels;
+    double pcm_start;
+} LoopCache;
+
+static int64_t loop_cache_bytes(const LoopCache* lc) {
+    return lc->frame_bytes + lc->packet_bytes + lc->pcm_cap * lc->channels * (int64_t)sizeof(float);
+}
+
+static void loop_cache_drop_frames(LoopCache* lc) {
+    for (int i = 0; i < lc->frame_count; i++) av_frame_free(&lc->frames[i]);
+    free(lc->frames);
+    free(lc->times);
+    lc->frames = NULL;
+    lc->times = NULL;
+    lc->frame_count = 0;
+    lc->frame_cap = 0;
+    lc->frame_bytes = 0;
+}
+
+static void loop_cache_drop_packets(LoopCache* lc) {
+    for (int i = 0; i < lc->packet_count; i++) av_packet_unref(&lc->packets[i]);
+    free(lc->packets);
+    budget_add(BUDGET_PACKETS, -lc->packet_bytes);
+    lc->packets = NULL;
+    lc->packet_count = 0;
+    lc->packet_cap = 0;
+    lc->packet_bytes = 0;
+}
+
+static void loop_cache_clear(LoopCache* lc) {
+    loop_cache_drop_frames(lc);
+    loop_cache_drop_packets(lc);
+    free(lc->pcm);
+    budget_add(BUDGET_AUDIO, -lc->pcm_cap * lc->channels * (int64_t)sizeof(float));
+    memset(lc, 0, sizeof(*lc));
+}
+
+static int loop_cache_push_frame(LoopCache* lc, const AVFrame* src, double t) {
+    if (lc->frame_count == lc->frame_cap) {
+        int cap = lc->frame_cap ? lc->frame_cap * 2 : 64;
+        AVFrame** frames = (AVFrame**)realloc(lc->frames, (size_t)cap * sizeof(*frames));
+        if (!frames) return 0;
+        lc->frames = frames;
+        double* times = (double*)realloc(lc->times, (size_t)cap * sizeof(*times));
+        if (!times) return 0;
+        lc->times = times;
+        lc->frame_cap = cap;
+    }
+    AVFrame* f = av_frame_clone(src);
+    if (!f) return 0;
+    lc->frames[lc->frame_count] = f;
+    lc->times[lc->frame_count] = t;
+    lc->frame_count++;
+    lc->frame_bytes += gop_frame_bytes(f);
+    return 1;
+}
+
+static int loop_cache_push_packet(LoopCache* lc, const AVPacket* pkt) {
+    if (lc->packet_count == lc->packet_cap) {
+        int cap = lc->packet_cap ? lc->packet_cap * 2 : 256;
+        AVPacket* packets = (AVPacket*)realloc(lc->packets, (size_t)cap * sizeof(*packets));
+        if (!packets) return 0;
+        lc->packets = packets;
+        lc->packet_cap = cap;
+    }
+    AVPacket* slot = &lc->packets[lc->packet_count];
+    memset(slot, 0, sizeof(*slot));
+    if (av_packet_ref(slot, pkt) < 0) return 0;
+    lc->packet_count++;
+    lc->packet_bytes += slot->size;
+    budget_add(BUDGET_PACKETS, slot->size);
+    return 1;
+}
+
+static int loop_cache_push_pcm(LoopCache* lc, const float* samples, int frames, int channels) {
+    if (lc->pcm_frames == 0) lc->channels = channels;
+    if (lc->pcm_frames + frames > lc->pcm_cap) {
+        int64_t cap = lc->pcm_cap ? lc->pcm_cap * 2 : 65536;
+        while (cap < lc->pcm_frames + frames) cap *= 2;
+        float* pcm = (float*)realloc(lc->pcm, (size_t)cap * channels * sizeof(float));
+        if (!pcm) return 0;
+        budget_add(BUDGET_AUDIO, (cap - lc->pcm_cap) * channels * (int64_t)sizeof(float));
+        lc->pcm = pcm;
+        lc->pcm_cap = cap;
+    }
+    memcpy(lc->pcm + lc->pcm_frames * channels, samples, (size_t)frames * channels * sizeof(float));
+    lc->pcm_frames += frames;
+    return 1;
+}
+
+/* Pads with silence in front, or trims the tail, so the PCM starts at `a`
+ * and lasts exactly `frames`. */
+static int loop_cache_fit_pcm(LoopCache* lc, double a, int64_t frames, int freq) {
+    int64_t lead = (int64_t)((lc->pcm_start - a) * freq + 0.5);
+    if (lead < 0) lead = 0;
+    if (lead > frames) lead = frames;
+    int64_t body = lc->pcm_frames < frames - lead ? lc->pcm_frames : frames - lead;
+    if (frames > lc->pcm_cap) {
+        float* pcm = (float*)realloc(lc->pcm, (size_t)frames * lc->channels * sizeof(float));
+        if (!pcm) return 0;
+        budget_add(BUDGET_AUDIO, (frames - lc->pcm_cap) * lc->channels * (int64_t)sizeof(float));
+        lc->pcm = pcm;
+        lc->pcm_cap = frames;
+    }
+    int ch = lc->channels;
+    memmove(lc->pcm + lead * ch, lc->pcm, (size_t)body * ch * sizeof(float));
+    memset(lc->pcm, 0, (size_t)lead * ch * sizeof(float));
+    memset(lc->pcm + (lead + body) * ch, 0, (size_t)(frames - lead - body) * ch * sizeof(float));
+    lc->pcm_frames = frames;
+    lc->pcm_start = a;
+    return 1;
+}
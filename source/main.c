@@ -25,8 +25,18 @@
 #undef NOB_IMPLEMENTATION
 
 #include "config.h"
+#include "budget.c"
 #include "text.c"
+#include "subtitles.c"
+#include "clock.c"
+#include "pool.c"
+#include "gop.c"
+#include "loop.c"
+#include "keyindex.c"
+#include "storyboard.c"
+#include "thumbs.c"
 #include "renderer.c"
+#include "present.c"
 
 #if SAVE_FILE
 #include "save.c"
@@ -44,12 +54,25 @@ typedef struct {
     const char *path;
 } FontEntry;
 
+typedef struct {
+    int w, h;
+    int cur_sec, dur_sec;
+    int timeline_px;
+    int volume;
+    int menus;
+    int audio_scroll, subtitle_scroll;
+    int current_audio, current_subtitle;
+    float playback_speed;
+    unsigned font_generation;
+} OverlayKey;
+
 static FontEntry default_fonts[] = DEFAULT_FONTS_MAP;
 static const int default_font_count =
     sizeof(default_fonts) / sizeof(default_fonts[0]);
 
 static int flash_debug_enabled = AMP_FLASH_DEBUG_DEFAULT;
 static int flash_debug_level = AMP_FLASH_DEBUG_LEVEL_DEFAULT;
+static SDL_threadID main_thread_id; /* only this thread may touch the flash */
 
 static float clampf(float v, float lo, float hi) {
     if (v < lo) return lo;
@@ -61,11 +84,108 @@ static float lerpf(float a, float b, float t) {
     return a + (b - a) * t;
 }
 
+static void wake_by(double* wake_at, double t) {
+    if (t < *wake_at) *wake_at = t;
+}
+
 static void draw_rect(SDL_Renderer* ren, SDL_Rect r, SDL_Color c) {
+    text_flush(ren);
     SDL_SetRenderDrawColor(ren, c.r, c.g, c.b, c.a);
     SDL_RenderFillRect(ren, &r);
 }
 
+static void draw_stats(SDL_Renderer* ren, int w, Presenter* ps, VideoRenderer* vr) {
+    char lines[STATS_MAX_LINES][128];
+    int n = 0;
+    snprintf(lines[n++], sizeof(lines[0]), "Display %.3f Hz (measured %.3f Hz)",
+             ps->refresh_hz, 1.0 / present_interval(ps));
+    if (vr && vr->video_ctx) {
+        AVStream* st = vr->fmt_ctx->streams[vr->video_stream_index];
+        double fps = st->avg_frame_rate.den > 0 ? av_q2d(st->avg_frame_rate) : 0.0;
+        snprintf(lines[n++], sizeof(lines[0]), "Video %dx%d %.3f fps", vr->width, vr->height, fps);
+    }
+    if (vr && vr->audio_dev) {
+        snprintf(lines[n++], sizeof(lines[0]), "A/V error %+.1f ms  correction %+d samples",
+                 vr_get_av_error(vr) * 1000.0, vr->av_correction);
+        snprintf(lines[n++], sizeof(lines[0]), "Audio buffer %.0f ms  target %.0f ms  device %d  underruns %d",
+                 vr_get_audio_queue_seconds(vr) * 1000.0, vr->audio_target * 1000.0,
+                 vr->audio_spec.samples, vr->audio_underruns);
+    }
+    if (vr && vr->fmt_ctx) {
+        PacketQueue* vq = &vr->video_pktq;
+        PacketQueue* aq = vr->audio_pktq;
+        snprintf(lines[n++], sizeof(lines[0]), "Packets video %.0f%% (%.1f MB, %.2f s)  audio %.0f%% (%.2f s)",
+                 pkt_queue_fill(vq) * 100.0, (double)vq->bytes / (1024.0 * 1024.0), pkt_queue_seconds(vq),
+                 pkt_queue_fill(aq) * 100.0, pkt_queue_seconds(aq));
+    }
+    for (int k = 0; k < FRAME_POOL_KINDS; k++) {
+        FramePoolStats* st = &frame_pool_stats[k];
+        int gets = SDL_AtomicGet(&st->gets);
+        if (gets == 0) continue;
+        snprintf(lines[n++], sizeof(lines[0]), "%s pool %d buffers %.1f MB  allocs %d  gets %d",
+                 k == FRAME_POOL_VIDEO ? "Frame" : "Sample", SDL_AtomicGet(&st->live),
+                 SDL_AtomicGet(&st->live_kb) / 1024.0, SDL_AtomicGet(&st->allocs), gets);
+    }
+    double mem_mb = (double)budget_total() / (1024.0 * 1024.0);
+    double peak_mb = (double)budget_get_peak() / (1024.0 * 1024.0);
+    if (budget_limit > 0)
+        snprintf(lines[n++], sizeof(lines[0]), "Memory %.1f MB of %.0f MB  peak %.1f MB", mem_mb,
+                 (double)budget_limit / (1024.0 * 1024.0), peak_mb);
+    else
+        snprintf(lines[n++], sizeof(lines[0]), "Memory %.1f MB  peak %.1f MB", mem_mb, peak_mb);
+    int len = 0;
+    for (int k = 0; k < BUDGET_COUNT && len < (int)sizeof(lines[0]); k++) {
+        len += snprintf(lines[n] + len, sizeof(lines[0]) - len, "%s%s %.1f", k ? "  " : "",
+                        budget_names[k], (double)budget_get((BudgetSubsystem)k) / (1024.0 * 1024.0));
+    }
+    n++;
+    if (vr && (vr->resume_video_ms > 0.0 || vr->resume_audio_ms > 0.0))
+        snprintf(lines[n++], sizeof(lines[0]), "Resume latency video %.1f ms  audio %.1f ms",
+                 vr->resume_video_ms, vr->resume_audio_ms);
+    if (vr)
+        snprintf(lines[n++], sizeof(lines[0]), "Seeks %lld requested  %lld performed  last decoded %d past the keyframe%s",
+                 (long long)vr->seek_requests, (long long)vr->seeks_done, SDL_AtomicGet(&vr->seek_skipped),
+                 vr_seeking(vr) ? "  (seeking)" : "");
+    if (vr && vr->gop.count > 0)
+        snprintf(lines[n++], sizeof(lines[0]), "GOP cache %d frames %.1f MB%s%s", vr->gop.count,
+                 (double)vr->gop.bytes / (1024.0 * 1024.0), vr->gop_next_ready ? "  previous ready" : "",
+                 vr->reversing ? "  reverse" : "");
+    if (vr && vr_get_loop(vr, NULL, NULL))
+        snprintf(lines[n++], sizeof(lines[0]), "Loop %.2f-%.2f s  video %s  audio %s  pass %lld  %.1f MB",
+                 vr->loop_a, vr->loop_b, loop_mode_names[vr->loop_video], loop_mode_names[vr->loop_audio],
+                 (long long)vr->loop_passes, (double)loop_cache_bytes(&vr->loop) / (1024.0 * 1024.0));
+    if (vr && vr->thumbs && thumb_worker_failed(vr->thumbs))
+        snprintf(lines[n++], sizeof(lines[0]), "Thumbnails unavailable");
+    else if (vr && vr->thumbs)
+        snprintf(lines[n++], sizeof(lines[0]), "Thumbnails %d decoded  storyboard %d of %d  evicted %d",
+                 SDL_AtomicGet(&vr->thumbs->decodes), SDL_AtomicGet(&vr->thumbs->storyboard_tiles),
+                 SDL_AtomicGet(&vr->thumbs->storyboard_count), SDL_AtomicGet(&vr->thumbs->storyboard_evicted));
+    if (vr && vr->key_builder)
+        snprintf(lines[n++], sizeof(lines[0]), "Keyframe index building %.0f%%", vr_key_index_progress(vr) * 100.0);
+    else if (vr && vr->key_index.count > 0)
+        snprintf(lines[n++], sizeof(lines[0]), "Keyframe index %lld keyframes", (long long)vr->key_index.count);
+    snprintf(lines[n++], sizeof(lines[0]), "Frames %llu  late %llu  dropped %llu",
+             (unsigned long long)ps->frames, (unsigned long long)ps->late, (unsigned long long)ps->dropped);
+    snprintf(lines[n++], sizeof(lines[0]), "Cadence 1:%llu 2:%llu 3:%llu 4:%llu 5:%llu 6+:%llu",
+             (unsigned long long)ps->cadence[0], (unsigned long long)ps->cadence[1], (unsigned long long)ps->cadence[2],
+             (unsigned long long)ps->cadence[3], (unsigned long long)ps->cadence[4], (unsigned long long)ps->cadence[5]);
+    snprintf(lines[n++], sizeof(lines[0]), "Judder avg %.2f ms  max %.2f ms", ps->judder_avg_ms, ps->judder_max_ms);
+
+    int line_h = TTF_FontLineSkip(ui_font);
+    int box_w = 0;
+    for (int i = 0; i < n; i++) {
+        int tw = 0, th = 0;
+        TTF_SizeUTF8(ui_font, lines[i], &tw, &th);
+        if (tw > box_w) box_w = tw;
+    }
+    SDL_Rect box = { w - box_w - 36, 12, box_w + 24, line_h * n + 16 };
+    SDL_SetRenderDrawBlendMode(ren, SDL_BLENDMODE_BLEND);
+    draw_rect(ren, box, (SDL_Color){ 20, 20, 24, 200 });
+    for (int i = 0; i < n; i++) {
+        draw_text(ren, box.x + 12, box.y + 8 + i * line_h, lines[i], (SDL_Color){ 230, 230, 235, 255 });
+    }
+}
+
 static void format_time(double seconds, char* out, size_t out_size) {
     if (!out || out_size == 0) return;
     int s = (int)seconds;
@@ -166,17 +286,21 @@ void amp_log_handler(Nob_Log_Level level, const char* fmt, va_list args) {
         case NOB_NO_LOGS: return;
     }
 
+    va_list flash_args;
+    va_copy(flash_args, args);
     fprintf(stderr, "[%s] [%s] ", timebuf, level_str);
     vfprintf(stderr, fmt, args);
     fprintf(stderr, "\n");
 
-    if (flash_debug_enabled && level == (Nob_Log_Level)flash_debug_level) {
+    /* workers (seeks, loop recording, thumbnails) log to stderr only */
+    if (flash_debug_enabled && level == (Nob_Log_Level)flash_debug_level && SDL_ThreadID() == main_thread_id) {
         char flash_buf[256];
-        vsnprintf(flash_buf, sizeof(flash_buf), fmt, args);
+        vsnprintf(flash_buf, sizeof(flash_buf), fmt, flash_args);
         snprintf(flash_text, sizeof(flash_text), "%s", flash_buf);
         flash_until = SDL_GetTicks() + 1200;
         flash_alpha = 1.0f;
     }
+    va_end(flash_args);
 }
 
 void usage(FILE* out, const char* prog_name) {
@@ -190,6 +314,10 @@ void usage(FILE* out, const char* prog_name) {
     fprintf(out, "  -m, --maximized              Start with window maximized\n");
     fprintf(out, "  --volume [0-200]             Set initial audio volume (default: 100)\n");
     fprintf(out, "  --speed [SPEED > 0]          Set initial playback speed (e.g. 0.5, 1.0, 1.5)\n");
+    fprintf(out, "  --stats                      Show playback statistics (toggle with I)\n");
+    fprintf(out, "  --low-latency                Keep a short audio buffer for faster seek and step feedback\n");
+    fprintf(out, "  --seek-mode [fast|exact]     Seek to the nearest keyframe or to the exact frame (default: exact)\n");
+    fprintf(out, "  --memory-budget [SIZE]       Cap memory used by queues, caches and textures (e.g. 512M, 1G)\n");
     fprintf(out, "  --flash-debug                Show log messages as on-screen flash\n");
     fprintf(out, "  --no-flash-debug             Disable on-screen flash for log messages\n");
     fprintf(out, "  --flash-debug-level [LEVEL]  Show log messages as on-screen flash (LEVEL: 0 - NO LOGS, 1 - INFO, 2 - WARNING, 3 - ERROR)\n");
@@ -315,6 +443,7 @@ HMENU create_windows_menu(SDL_Window* window) {
 #endif
 
 int main(int argc, char** argv) {
+    main_thread_id = SDL_ThreadID();
     nob_set_log_handler(amp_log_handler);
 
     VideoRenderer* vr = NULL;
@@ -335,7 +464,14 @@ int main(int argc, char** argv) {
     bool subtitle_menu_open = false;
     bool font_menu_open = false;
     bool playback_menu_open = false;
+    bool show_stats = false;
+    bool low_latency = false;
+    bool show_info = false;
+    VrSeekMode seek_mode = VR_SEEK_EXACT;
     double drag_time = 0.0;
+    double drag_origin = 0.0;
+    double scrub_time = -1.0;
+    double scrub_last = 0.0;
     double timestamp_history[MAX_HISTORY] = {0};
     int history_pos = 0;
     int history_count = 0;
@@ -381,6 +517,27 @@ int main(int argc, char** argv) {
                 nob_log(NOB_WARNING, "Invalid playback speed: %s. Must be > 0.", argv[i + 1]);
             }
             i++;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            show_stats = true;
+        } else if (strcmp(argv[i], "--low-latency") == 0) {
+            low_latency = true;
+        } else if (strcmp(argv[i], "--seek-mode") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i + 1], "fast") == 0)
+                seek_mode = VR_SEEK_FAST;
+            else if (strcmp(argv[i + 1], "exact") == 0)
+                seek_mode = VR_SEEK_EXACT;
+            else {
+                nob_log(NOB_WARNING, "Invalid seek mode: %s. Must be fast or exact.", argv[i + 1]);
+            }
+            i++;
+        } else if (strcmp(argv[i], "--memory-budget") == 0 && i + 1 < argc) {
+            int64_t limit = budget_parse_size(argv[i + 1]);
+            if (limit > 0)
+                budget_limit = limit;
+            else {
+                nob_log(NOB_WARNING, "Invalid memory budget: %s. Use a size such as 512M or 1G.", argv[i + 1]);
+            }
+            i++;
         } else if (strcmp(argv[i], "--fullscreen") == 0 || strcmp(argv[i], "-f") == 0) {
             fullscreen = true;
         } else if (strcmp(argv[i], "--maximized") == 0 || strcmp(argv[i], "-m") == 0) {
@@ -392,27 +549,32 @@ int main(int argc, char** argv) {
             fprintf(stdout, "amp version %d.%d.%d\n", (AMP_VERSION >> 16) & 0xFF, (AMP_VERSION >> 8) & 0xFF, AMP_VERSION & 0xFF);
             return 0;
         } else if (strcmp(argv[i], "--info") == 0 || strcmp(argv[i], "-i") == 0) {
-            fprintf(stdout, "amp - A simple video player\n");
-            fprintf(stdout, "version: %d.%d.%d\n", (AMP_VERSION >> 16) & 0xFF, (AMP_VERSION >> 8) & 0xFF, AMP_VERSION & 0xFF);
-            usage(stdout, argv[0]);
-            fprintf(stdout, "Compiled with:\n");
-            fprintf(stdout, "  Nob version: %s\n", NOB_VERSION);
-            fprintf(stdout, "  SDL2 version: %d.%d.%d\n", SDL_MAJOR_VERSION, SDL_MINOR_VERSION, SDL_PATCHLEVEL);
-            fprintf(stdout, "  TTF version: %d.%d.%d\n", TTF_MAJOR_VERSION, TTF_MINOR_VERSION, TTF_PATCHLEVEL);
-            fprintf(stdout, "  FFmpeg version: %d.%d.%d\n", LIBAVFORMAT_VERSION_MAJOR, LIBAVFORMAT_VERSION_MINOR, LIBAVFORMAT_VERSION_MICRO);
-            fprintf(stdout, "  LibAss version: %d.%d.%d\n", (LIBASS_VERSION >> 24) & 0xFF, (LIBASS_VERSION >> 16) & 0xFF, (LIBASS_VERSION >> 8) & 0xFF);
-            fprintf(stdout, "  Compiler: %s ", CC);
-            const char* flags[] = { CFLAGS, NULL };
-            for (int j = 0; flags[j]; j++) fprintf(stdout, "%s ", flags[j]);
-            fprintf(stdout, "\n");
-            fprintf(stdout, "(c) 2026 Markofwitch. All rights reserved.\n");
-            return 0;
+            show_info = true;
         } else if (argv[i][0] != '-') {
             video_file = get_absolute_path(argv[i]);
         } else {
             nob_log(NOB_WARNING, "Unknown argument: %s", argv[i]);
         }
     }
+    /* after every flag, so the report reflects the whole command line */
+    if (show_info) {
+        fprintf(stdout, "amp - A simple video player\n");
+        fprintf(stdout, "version: %d.%d.%d\n", (AMP_VERSION >> 16) & 0xFF, (AMP_VERSION >> 8) & 0xFF, AMP_VERSION & 0xFF);
+        usage(stdout, argv[0]);
+        fprintf(stdout, "Compiled with:\n");
+        fprintf(stdout, "  Nob version: %s\n", NOB_VERSION);
+        fprintf(stdout, "  SDL2 version: %d.%d.%d\n", SDL_MAJOR_VERSION, SDL_MINOR_VERSION, SDL_PATCHLEVEL);
+        fprintf(stdout, "  TTF version: %d.%d.%d\n", TTF_MAJOR_VERSION, TTF_MINOR_VERSION, TTF_PATCHLEVEL);
+        fprintf(stdout, "  FFmpeg version: %d.%d.%d\n", LIBAVFORMAT_VERSION_MAJOR, LIBAVFORMAT_VERSION_MINOR, LIBAVFORMAT_VERSION_MICRO);
+        fprintf(stdout, "  LibAss version: %d.%d.%d\n", (LIBASS_VERSION >> 24) & 0xFF, (LIBASS_VERSION >> 16) & 0xFF, (LIBASS_VERSION >> 8) & 0xFF);
+        fprintf(stdout, "  Compiler: %s ", CC);
+        const char* flags[] = { CFLAGS, NULL };
+        for (int j = 0; flags[j]; j++) fprintf(stdout, "%s ", flags[j]);
+        fprintf(stdout, "\n");
+        budget_report(stdout);
+        fprintf(stdout, "(c) 2026 Markofwitch. All rights reserved.\n");
+        return 0;
+    }
     
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) != 0) {
         nob_log(NOB_ERROR, "SDL_Init Error: %s", SDL_GetError());
@@ -475,8 +637,26 @@ int main(int argc, char** argv) {
     SDL_Renderer* ren = SDL_CreateRenderer(win, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
     if(!ren) { SDL_DestroyWindow(win); nob_log(NOB_ERROR, "SDL_CreateRenderer failed: %s", SDL_GetError()); return 1; }
 
+    SDL_Texture* overlay_tex = NULL;
+    int overlay_tex_w = 0, overlay_tex_h = 0;
+    bool overlay_valid = false;
+    bool overlay_retained = SDL_RenderTargetSupported(ren);
+    OverlayKey overlay_key;
+    memset(&overlay_key, 0, sizeof(overlay_key));
+    SDL_Texture* thumb_tex = NULL;
+    int64_t thumb_tex_bucket = -1;
+    ThumbWorker* thumb_owner = NULL;
+    int hover_x = -1;
+    bool thumb_waiting = false;
+    bool window_hidden = false; /* minimized or hidden: no rendering, audio-only decoding */
+    SDL_BlendMode overlay_blend = SDL_ComposeCustomBlendMode(
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+
     if(video_file) {
         vr = vr_create(win, ren);
+        vr_set_low_latency(vr, low_latency);
+        vr_set_seek_mode(vr, seek_mode);
         if(vr_load(vr, video_file)) {
             vr_set_volume(vr, volume_percent_to_gain(volume_percent));
             SDL_SetWindowTitle(win, video_file);
@@ -509,8 +689,15 @@ int main(int argc, char** argv) {
     int overlay_h = 100;
     int margin = 24;
     int w, h;
+    Presenter presenter;
+    present_init(&presenter, win);
+    double wake_at = 0.0;
+    bool redraw = true;
 
     while(running) {
+        double remaining = wake_at - present_now(&presenter);
+        if (remaining >= 0.001) SDL_WaitEventTimeout(NULL, (int)(remaining * 1000.0));
+
         {
             SDL_GetWindowSize(win, &w, &h);
             overlay_rect = (SDL_Rect){ 0, h - overlay_h, w, overlay_h };
@@ -531,11 +718,28 @@ int main(int argc, char** argv) {
         }
 
         while(SDL_PollEvent(&e)) {
+            redraw = true;
             if(e.type == SDL_QUIT) running = false;
+            if(e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET) overlay_valid = false;
+            if(e.type == SDL_WINDOWEVENT && (e.window.event == SDL_WINDOWEVENT_DISPLAY_CHANGED || e.window.event == SDL_WINDOWEVENT_MOVED)) {
+                present_update_refresh(&presenter, win);
+            }
 
             if(e.type == SDL_MOUSEMOTION) {
                 last_mouse_move = SDL_GetTicks();
                 overlay_target = 1.0f;
+                hover_x = point_in_rect(e.motion.x, e.motion.y, timeline_hitbox) ? e.motion.x : -1;
+            }
+            if(e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_LEAVE) hover_x = -1;
+            if(e.type == SDL_WINDOWEVENT) {
+                bool hide = e.window.event == SDL_WINDOWEVENT_MINIMIZED || e.window.event == SDL_WINDOWEVENT_HIDDEN;
+                bool show = e.window.event == SDL_WINDOWEVENT_RESTORED || e.window.event == SDL_WINDOWEVENT_SHOWN
+                         || e.window.event == SDL_WINDOWEVENT_MAXIMIZED;
+                if ((hide && !window_hidden) || (show && window_hidden)) {
+                    window_hidden = hide;
+                    vr_set_hidden(vr, hide);
+                    present_restart(&presenter);
+                }
             }
 
 #ifdef _WIN32
@@ -551,7 +755,13 @@ int main(int argc, char** argv) {
                             );
                             if(f) {
                                 video_file = f;
-                                if(!vr) vr = vr_create(win, ren);
+                                if(!vr) {
+                                    vr = vr_create(win, ren);
+                                    vr_set_low_latency(vr, low_latency);
+                                    vr_set_seek_mode(vr, seek_mode);
+                                }
+                                overlay_valid = false;
+                                present_reset_stats(&presenter);
                                 if(vr_load(vr, f)) {
                                     fill_save_state_from_vr(vr, &save_state, video_file);
                                     vr_set_volume(vr, volume_percent_to_gain(volume_percent));
@@ -569,7 +779,13 @@ int main(int argc, char** argv) {
                             int idx = id - MENU_RECENT_BASE;
                             if(idx < recent_count) {
                                 strcpy(video_file, recent_files[idx]);
-                                if(!vr) vr = vr_create(win, ren);
+                                if(!vr) {
+                                    vr = vr_create(win, ren);
+                                    vr_set_low_latency(vr, low_latency);
+                                    vr_set_seek_mode(vr, seek_mode);
+                                }
+                                overlay_valid = false;
+                                present_reset_stats(&presenter);
                                 if(vr_load(vr, video_file)) {
                                     fill_save_state_from_vr(vr, &save_state, video_file);
                                     vr_set_volume(vr, volume_percent_to_gain(volume_percent));
@@ -611,10 +827,10 @@ int main(int argc, char** argv) {
                             paused = !paused;
                             if (vr) vr_set_paused(vr, paused);
                             overlay_target = 1.0f;
-                        } else if(id == MENU_NEXT_FRAME && vr) {
-                            vr_next_frame(vr, 1);
-                        } else if(id == MENU_PREV_FRAME && vr) {
-                            vr_next_frame(vr, -1);
+                        } else if((id == MENU_NEXT_FRAME || id == MENU_PREV_FRAME) && vr) {
+                            paused = true;
+                            vr_set_paused(vr, paused);
+                            vr_next_frame(vr, id == MENU_NEXT_FRAME ? 1 : -1);
                         } else if(id == MENU_NEXT_MEDIA || id == MENU_PREV_MEDIA) {
                             nob_log(NOB_WARNING, "Playlist functionality not implemented yet");
                             sprintf(flash_text, "%s not implemented", id == MENU_NEXT_MEDIA ? "Next Media" : "Previous Media");
@@ -634,7 +850,13 @@ int main(int argc, char** argv) {
                     );
                     if(f) {
                         video_file = f;
-                        if(!vr) vr = vr_create(win, ren);
+                        if(!vr) {
+                            vr = vr_create(win, ren);
+                            vr_set_low_latency(vr, low_latency);
+                            vr_set_seek_mode(vr, seek_mode);
+                        }
+                        overlay_valid = false;
+                        present_reset_stats(&presenter);
                         if(vr_load(vr, f)) {
                             fill_save_state_from_vr(vr, &save_state, video_file);
                             vr_set_volume(vr, volume_percent_to_gain(volume_percent));
@@ -689,11 +911,15 @@ int main(int argc, char** argv) {
                 if (key == SDLK_LEFT && (e.key.keysym.mod & KMOD_ALT) && vr) {
                     sprintf(flash_text, "Previous Frame");
                     flash_until = SDL_GetTicks() + 900;
+                    paused = true;
+                    vr_set_paused(vr, paused);
                     vr_next_frame(vr, -1);
                 }
                 if (key == SDLK_RIGHT && (e.key.keysym.mod & KMOD_ALT) && vr) {
                     sprintf(flash_text, "Next Frame");
                     flash_until = SDL_GetTicks() + 900;
+                    paused = true;
+                    vr_set_paused(vr, paused);
                     vr_next_frame(vr, 1);
                 }
                 if (key == SDLK_RIGHT && (e.key.keysym.mod & KMOD_SHIFT) && vr) {
@@ -728,6 +954,39 @@ int main(int argc, char** argv) {
                         maximized = true;
                     }
                 }
+                if (key == SDLK_i && !(e.key.keysym.mod & (KMOD_CTRL | KMOD_ALT))) {
+                    show_stats = !show_stats;
+                }
+                if (key == SDLK_r && !(e.key.keysym.mod & (KMOD_CTRL | KMOD_ALT)) && vr) {
+                    vr_set_reverse(vr, !vr_reversing(vr));
+                    snprintf(flash_text, sizeof(flash_text), "%s", vr_reversing(vr) ? "Reverse" : "Forward");
+                    flash_until = SDL_GetTicks() + 900;
+                }
+                /* L marks A, then B, then ends the loop */
+                if (key == SDLK_l && !(e.key.keysym.mod & (KMOD_CTRL | KMOD_ALT)) && vr) {
+                    double t = vr_get_time(vr);
+                    char a_text[32], b_text[32];
+                    if (vr_get_loop(vr, NULL, NULL)) {
+                        vr_clear_loop(vr);
+                        snprintf(flash_text, sizeof(flash_text), "Loop off");
+                    } else if (vr->loop_mark < 0.0) {
+                        vr->loop_mark = t;
+                        format_time(t, a_text, sizeof(a_text));
+                        snprintf(flash_text, sizeof(flash_text), "Loop from %s", a_text);
+                    } else {
+                        double a, b;
+                        vr_set_loop(vr, vr->loop_mark, t);
+                        vr->loop_mark = -1.0;
+                        if (vr_get_loop(vr, &a, &b)) {
+                            format_time(a, a_text, sizeof(a_text));
+                            format_time(b, b_text, sizeof(b_text));
+                            snprintf(flash_text, sizeof(flash_text), "Loop %s - %s", a_text, b_text);
+                        } else {
+                            snprintf(flash_text, sizeof(flash_text), "Loop too short");
+                        }
+                    }
+                    flash_until = SDL_GetTicks() + 900;
+                }
                 if (key == SDLK_SPACE) {
                     paused = !paused;
                     if (vr) vr_set_paused(vr, paused);
@@ -881,10 +1140,8 @@ int main(int argc, char** argv) {
                             item_h * display_count
                         };
                         if (list.x < margin) list.x = margin;
-                        int win_w, win_h;
-                        SDL_GetWindowSize(win, &win_w, &win_h);
-                        if (list.y + list.h > win_h) {
-                            list.y = win_h - list.h;
+                        if (list.y + list.h > h) {
+                            list.y = h - list.h;
                             if (list.y < margin) list.y = margin;
                         }
                         if (point_in_rect(mx, my, list)) {
@@ -947,10 +1204,8 @@ int main(int argc, char** argv) {
                         int item_h = MENU_DROPDOWN_ITEM_HEIGHT;
                         SDL_Rect list = { menu_panel.x - MENU_DROPDOWN_WIDTH, playback_box.y, MENU_DROPDOWN_WIDTH, item_h * 8 };
                         if (list.x < margin) list.x = margin;
-                        int win_w, win_h;
-                        SDL_GetWindowSize(win, &win_w, &win_h);
-                        if (list.y + list.h > win_h) {
-                            list.y = win_h - list.h;
+                        if (list.y + list.h > h) {
+                            list.y = h - list.h;
                             if (list.y < 0) list.y = 0;
                         }
                         if (point_in_rect(mx, my, list)) {
@@ -960,7 +1215,7 @@ int main(int argc, char** argv) {
                                 playback_speed = speeds[idx];
                                 if (vr) {
                                     vr_set_speed(vr, playback_speed);
-                                    SDL_ClearQueuedAudio(vr->audio_dev);
+                                    vr_clear_audio(vr);
                                     if (playback_speed > 2.0f) {
                                         vr->audio_clock_valid = 0;
                                     }
@@ -988,6 +1243,8 @@ int main(int argc, char** argv) {
                             double t = (double)(mx - timeline_rect.x) / (double)timeline_rect.w;
                             t = clampf((float)t, 0.0f, 1.0f);
                             drag_time = t * dur;
+                            drag_origin = vr_get_time(vr);
+                            scrub_time = -1.0;
                             dragging_timeline = true;
                         }
                         click_processed = true;
@@ -1011,11 +1268,11 @@ int main(int argc, char** argv) {
                         history_count = history_pos;
                     }
                     if (history_count < MAX_HISTORY) {
-                        timestamp_history[history_count] = vr_get_time(vr);
+                        timestamp_history[history_count] = drag_origin;
                         history_count++;
                         history_pos = history_count;
                     }
-                    vr_seek(vr, seek_time);
+                    vr_seek_exact(vr, seek_time);
                 }
                 dragging_timeline = false;
                 volume_dragging = false;
@@ -1044,55 +1301,127 @@ int main(int argc, char** argv) {
 
         Uint32 now = SDL_GetTicks();
         float dt = (now - last_tick) / 1000.0f;
+        if (dt > 0.05f) dt = 0.05f;
         last_tick = now;
+        double now_s = present_now(&presenter);
+        wake_at = now_s + LOOP_IDLE_WAIT_MS / 1000.0;
+        if (vr) vr_poll_key_index(vr);
+        if (vr && vr_seek_poll(vr)) redraw = true;
+        if (vr && dragging_timeline && !vr_seeking(vr) && drag_time != scrub_time) {
+            /* one scrub in flight at a time, spaced by what the last ones cost */
+            double next = scrub_last + vr_scrub_interval(vr);
+            if (now_s >= next) {
+                vr_scrub(vr, drag_time);
+                scrub_time = drag_time;
+                scrub_last = now_s;
+            } else {
+                wake_by(&wake_at, next);
+            }
+        }
+        if (vr_seeking(vr)) wake_by(&wake_at, now_s + 0.004);
         if (!dragging_timeline && !volume_dragging && !menu_open && !audio_menu_open && !subtitle_menu_open && !font_menu_open && !playback_menu_open) {
             if (now - last_mouse_move > 3000) overlay_target = 0.0f;
+            else if (overlay_target > 0.0f) wake_by(&wake_at, now_s + (last_mouse_move + 3000 - now) / 1000.0);
         }
-        
+
+        bool animating = false;
         overlay_alpha = lerpf(overlay_alpha, overlay_target, clampf(dt * 6.0f, 0.0f, 1.0f));
+        if (fabsf(overlay_alpha - overlay_target) < 0.01f) overlay_alpha = overlay_target;
+        else animating = true;
 
-        SDL_SetRenderDrawColor(ren,0,0,0,255);
-        SDL_RenderClear(ren);
+        float pause_target = paused ? 1.0f : 0.0f;
+        pause_alpha = lerpf(pause_alpha, pause_target, clampf(dt * 6.0f, 0.0f, 1.0f));
+        if (fabsf(pause_alpha - pause_target) < 0.01f) pause_alpha = pause_target;
+        else animating = true;
 
-        if(vr) {
-            if (!paused) {
-                vr_demux_packets(vr);
-                if (playback_speed <= 2.0f) {
-                    vr_decode_audio(vr);
+        if (flash_text[0]) {
+            if (now < flash_until) {
+                flash_alpha = lerpf(flash_alpha, 1.0f, clampf(dt * 8.0f, 0.0f, 1.0f));
+                if (flash_alpha < 0.99f) animating = true;
+                else wake_by(&wake_at, now_s + (flash_until - now) / 1000.0);
+            } else {
+                flash_alpha = lerpf(flash_alpha, 0.0f, clampf(dt * 6.0f, 0.0f, 1.0f));
+                if (flash_alpha < 0.01f) flash_text[0] = 0;
+                animating = true;
+            }
+        }
+
+        if (animating) {
+            redraw = true;
+            wake_by(&wake_at, presenter.last_vsync + present_interval(&presenter) * 0.5);
+        }
+
+        bool new_frame = false;
+        double media_rate = 1.0;
+        if (paused) present_restart(&presenter);
+        if (vr && !paused && vr_reversing(vr)) {
+            int shown = 0;
+            double next = vr_reverse_tick(vr, &shown);
+            if (shown) {
+                new_frame = true;
+                redraw = true;
+            }
+            media_rate = playback_speed;
+            wake_by(&wake_at, now_s + next);
+        } else if(vr && !paused && !vr_seeking(vr)) {
+            vr_demux_packets(vr);
+            bool audio_sync = vr->audio_dev && playback_speed <= 2.0f;
+            if (audio_sync) vr_decode_audio(vr);
+            /* at normal speed the audio is resampled to follow the master clock;
+             * other speeds do not stretch audio, so video follows it instead */
+            bool audio_clock = audio_sync && playback_speed != 1.0f;
+            double clock = audio_clock ? vr_get_audio_time(vr) : vr_get_master_time(vr);
+            if (!audio_clock) media_rate = playback_speed;
+
+            int dropped = 0;
+            while (!vr->hidden && vr_decode_video(vr)) {
+                double due = now_s + (vr->frame_pending_time - clock) / media_rate;
+                if (!present_is_due(&presenter, due)) {
+                    wake_by(&wake_at, present_submit_time(&presenter, due));
+                    break;
                 }
-                vr_render_frame(vr);
-                if (vr->audio_dev && playback_speed <= 2.0f) {
-                    double video_time = vr_get_video_time(vr);
-                    double audio_time = vr_get_audio_time(vr);
-                    double diff = video_time - audio_time;
-
-                    if (diff < -0.05) {
-                        int catchup = 0;
-                        while (diff < -0.02 && catchup < 8) {
-                            if (!vr_render_frame(vr)) break;
-                            video_time = vr_get_video_time(vr);
-                            audio_time = vr_get_audio_time(vr);
-                            diff = video_time - audio_time;
-                            catchup++;
-                        }
-                    } else if (diff > 0.01) {
-                        int delay_ms = (int)(diff * 1000.0);
-                        if (delay_ms > 120) delay_ms = 120;
-                        SDL_Delay(delay_ms);
-                    }
-                } else {
-                    double master_time = vr_get_master_time(vr);
-                    double video_time = vr_get_video_time(vr);
-                    int catchup = 0;
-                    while (video_time < master_time - 0.001 && catchup < 30) {
-                        vr_demux_packets(vr);
-                        if (!vr_render_frame(vr)) break;
-                        video_time = vr_get_video_time(vr);
-                        catchup++;
-                    }
-                    SDL_Delay(1);
+                if (due < now_s - present_interval(&presenter) && dropped < PRESENT_MAX_DROPS) {
+                    vr_drop_frame(vr);
+                    presenter.dropped++;
+                    dropped++;
+                    vr_demux_packets(vr);
+                    continue;
                 }
+                vr_upload_frame(vr);
+                new_frame = true;
+                redraw = true;
+                break;
+            }
+
+            double refill = vr_audio_refill_delay(vr);
+            if (audio_sync && refill >= 0.0) wake_by(&wake_at, now_s + refill);
+            if (!vr->video_ctx) {
+                redraw = true;
+                wake_by(&wake_at, now_s + 0.1);
+            } else if (!vr->hidden && !vr->frame_pending && !vr->eof) {
+                wake_at = now_s;
             }
+        } else if (vr && paused && !vr_seeking(vr)) {
+            if (vr_prime(vr, vr->audio_dev && playback_speed <= 2.0f)) wake_at = now_s;
+        }
+        if (vr && vr->active_subfile && !vr->subfile_attached) {
+            redraw = true;
+            wake_by(&wake_at, now_s + 0.05);
+        }
+
+        if (thumb_waiting) {
+            redraw = true;
+            wake_by(&wake_at, now_s + 0.02);
+        }
+
+        if (!redraw) continue;
+        if (window_hidden) continue; /* nothing to draw into; redraw stays set for the restore */
+        redraw = false;
+
+        SDL_SetRenderDrawColor(ren,0,0,0,255);
+        SDL_RenderClear(ren);
+
+        if(vr) {
             SDL_Texture* tex = vr_get_texture(vr);
             if (tex) SDL_RenderCopy(ren, tex, NULL, NULL);
             if (vr_render_subtitles(vr, vr_get_time(vr))) {
@@ -1102,231 +1431,305 @@ int main(int argc, char** argv) {
         }
 
         if (overlay_alpha > 0.01f) {
-            SDL_SetRenderDrawBlendMode(ren, SDL_BLENDMODE_BLEND);
-            int w, h;
-            SDL_GetWindowSize(win, &w, &h);
-
-            SDL_Color panel = { 20, 20, 24, (Uint8)(200 * overlay_alpha) };
-            SDL_Color text = { 230, 230, 235, (Uint8)(255 * overlay_alpha) };
-            SDL_Color accent = { 68, 160, 255, (Uint8)(230 * overlay_alpha) };
-            SDL_Color muted = { 120, 120, 130, (Uint8)(200 * overlay_alpha) };
-
-            draw_rect(ren, overlay_rect, panel);
-
             double cur = vr ? (dragging_timeline ? drag_time : vr_get_time(vr)) : 0.0;
             double dur = vr ? vr_get_duration(vr) : 0.0;
             float t = (dur > 0.0) ? (float)(cur / dur) : 0.0f;
             t = clampf(t, 0.0f, 1.0f);
 
-            SDL_Rect base = timeline_rect;
-            base.h = 6;
-            draw_rect(ren, base, (SDL_Color){ 70, 70, 80, (Uint8)(180 * overlay_alpha) });
-            SDL_Rect fill = { base.x, base.y, (int)(base.w * t), base.h };
-            draw_rect(ren, fill, accent);
-            SDL_Rect handle = { base.x + (int)(base.w * t) - 6, base.y - 4, 12, 12 };
-            draw_rect(ren, handle, (SDL_Color){ 220, 220, 230, (Uint8)(220 * overlay_alpha) });
-
-            char left_time[32];
-            char right_time[32];
-            format_time(cur, left_time, sizeof(left_time));
-            format_time(dur, right_time, sizeof(right_time));
-            draw_text_shadow(ren, margin, h - overlay_h + 24, left_time, text);
-            int right_w = 0, right_h = 0;
-            TTF_SizeUTF8(ui_font, right_time, &right_w, &right_h);
-            draw_text_shadow(ren, w - margin - right_w - 40, h - overlay_h + 24, right_time, text);
-
-            draw_rect(ren, volume_rect, (SDL_Color){ 70, 70, 80, (Uint8)(180 * overlay_alpha) });
-            float vol_t = clampf(volume_percent / 200.0f, 0.0f, 1.0f);
-            SDL_Rect vol_fill = { volume_rect.x, volume_rect.y + (int)(volume_rect.h * (1.0f - vol_t)), volume_rect.w, (int)(volume_rect.h * vol_t) };
-            draw_rect(ren, vol_fill, accent);
-            char vol_text[32];
-            snprintf(vol_text, sizeof(vol_text), "%d%%", (int)volume_percent);
-            draw_text_shadow(ren, volume_rect.x - 28, volume_rect.y + volume_rect.h + 6, vol_text, muted);
-
-            draw_rect(ren, hamburger, (SDL_Color){ 35, 35, 45, (Uint8)(200 * overlay_alpha) });
-            draw_text_shadow(ren, hamburger.x + 6, hamburger.y + 2, "≡", text);
-
-            if (menu_open) {
-                draw_rect(ren, menu_panel, (SDL_Color){ 28, 28, 36, (Uint8)(220 * overlay_alpha) });
-                draw_rect(ren, audio_box, (SDL_Color){ 35, 35, 45, (Uint8)(200 * overlay_alpha) });
-                draw_rect(ren, subtitle_box, (SDL_Color){ 35, 35, 45, (Uint8)(200 * overlay_alpha) });
-                draw_rect(ren, font_box, (SDL_Color){ 35, 35, 45, (Uint8)(200 * overlay_alpha) });
-                draw_rect(ren, playback_box, (SDL_Color){ 35, 35, 45, (Uint8)(200 * overlay_alpha) });
-
-                char audio_label[160];
-                if (vr && vr_get_audio_track_count(vr) > 0) {
-                    snprintf(audio_label, sizeof(audio_label), "Audio: %s", vr_get_audio_track_name(vr, vr->current_audio));
-                } else {
-                    snprintf(audio_label, sizeof(audio_label), "Audio");
+            OverlayKey key;
+            memset(&key, 0, sizeof(key));
+            key.w = w;
+            key.h = h;
+            key.cur_sec = (int)cur;
+            key.dur_sec = (int)dur;
+            key.timeline_px = (int)(timeline_rect.w * t);
+            key.volume = (int)volume_percent;
+            key.menus = (menu_open << 0) | (audio_menu_open << 1) | (subtitle_menu_open << 2)
+                      | (font_menu_open << 3) | (playback_menu_open << 4);
+            key.audio_scroll = audio_scroll;
+            key.subtitle_scroll = subtitle_scroll;
+            key.current_audio = vr ? vr->current_audio : -1;
+            key.current_subtitle = vr ? vr->current_subtitle : -1;
+            key.playback_speed = playback_speed;
+            key.font_generation = ui_font_generation;
+
+            bool retained = overlay_retained;
+            if (retained && (!overlay_tex || overlay_tex_w != w || overlay_tex_h != h)) {
+                if (overlay_tex) {
+                    SDL_DestroyTexture(overlay_tex);
+                    budget_add(BUDGET_UI, -(int64_t)overlay_tex_w * overlay_tex_h * 4);
                 }
-                const char* sub_name = (vr && vr_get_subtitle_track_count(vr) > 0 && vr->current_subtitle >= 0) ? vr_get_subtitle_track_name(vr, vr->current_subtitle) : "Subtitles: Off";
-                char font_label[160];
-                snprintf(font_label, sizeof(font_label), "Font: %s", ui_font_label);
-                char playback_label[160];
-                char tmp[64];
-                snprintf(tmp, sizeof(tmp), "%.6f", playback_speed);
-                char *dot = strchr(tmp, '.');
-                char *end = tmp + strlen(tmp) - 1;
-                while (end > dot + 1 && *end == '0') *end-- = '\0';
-                snprintf(playback_label, sizeof(playback_label), "Speed: %sx", tmp);
-                draw_text_shadow(ren, audio_box.x + 8, audio_box.y + 3, audio_label, text);
-                draw_text_shadow(ren, subtitle_box.x + 8, subtitle_box.y + 3, sub_name, text);
-                draw_text_shadow(ren, font_box.x + 8, font_box.y + 3, font_label, text);
-                draw_text_shadow(ren, playback_box.x + 8, playback_box.y + 3, playback_label, text);
-
-                if (audio_menu_open && vr) {
-                    int count = vr_get_audio_track_count(vr);
-                    int max_items = MENU_MAX_VISIBLE_ITEMS;
-                    int item_h = MENU_DROPDOWN_ITEM_HEIGHT;
-                    int display_count = count > max_items ? max_items : count;
-                    SDL_Rect list = { menu_panel.x - MENU_DROPDOWN_WIDTH, audio_box.y, MENU_DROPDOWN_WIDTH, item_h * display_count };
-                    if (list.x < margin) list.x = margin;
-                    
-                    int max_scroll = count > max_items ? count - max_items : 0;
-                    if (audio_scroll > max_scroll) audio_scroll = max_scroll;
-                    if (audio_scroll < 0) audio_scroll = 0;
-                    
-                    draw_rect(ren, list, (SDL_Color){ 26, 26, 34, (Uint8)(220 * overlay_alpha) });
-                    for (int i = 0; i < display_count; i++) {
-                        int idx = audio_scroll + i;
-                        SDL_Rect item = { list.x, list.y + i * item_h, list.w - (count > max_items ? MENU_DROPDOWN_SCROLLBAR_WIDTH : 0), item_h };
-                        if (vr->current_audio == idx) draw_rect(ren, item, (SDL_Color){ 40, 80, 120, (Uint8)(180 * overlay_alpha) });
-                        draw_text_shadow(ren, item.x + MENU_DROPDOWN_TEXT_PADDING_X, item.y + MENU_DROPDOWN_TEXT_PADDING_Y, vr_get_audio_track_name(vr, idx), text);
-                    }
-                    
-                    if (count > max_items) {
-                        SDL_Rect scrollbar_bg = { list.x + list.w - MENU_DROPDOWN_SCROLLBAR_WIDTH, list.y, MENU_DROPDOWN_SCROLLBAR_WIDTH, list.h };
-                        draw_rect(ren, scrollbar_bg, (SDL_Color){ 35, 35, 45, (Uint8)(200 * overlay_alpha) });
-                        int scroll_h = (max_items * list.h) / count;
-                        int scroll_y = list.y + (audio_scroll * list.h) / count;
-                        SDL_Rect scrollbar = { list.x + list.w - MENU_DROPDOWN_SCROLLBAR_WIDTH, scroll_y, MENU_DROPDOWN_SCROLLBAR_WIDTH, scroll_h };
-                        draw_rect(ren, scrollbar, (SDL_Color){ 80, 80, 100, (Uint8)(220 * overlay_alpha) });
+                overlay_tex = SDL_CreateTexture(ren, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, w, h);
+                overlay_tex_w = w;
+                overlay_tex_h = h;
+                if (overlay_tex) budget_add(BUDGET_UI, (int64_t)w * h * 4);
+                overlay_valid = false;
+                if (!overlay_tex || SDL_SetTextureBlendMode(overlay_tex, overlay_blend) != 0) {
+                    nob_log(NOB_WARNING, "Retained overlay unavailable, drawing it every frame: %s", SDL_GetError());
+                    if (overlay_tex) {
+                        SDL_DestroyTexture(overlay_tex);
+                        budget_add(BUDGET_UI, -(int64_t)w * h * 4);
                     }
+                    overlay_tex = NULL;
+                    overlay_retained = retained = false;
                 }
+            }
 
-                if (subtitle_menu_open && vr) {
-                    int count = vr_get_subtitle_track_count(vr);
-                    int max_items = MENU_MAX_VISIBLE_ITEMS;
-                    int item_h = MENU_DROPDOWN_ITEM_HEIGHT;
-                    int display_count = (count + 1) > max_items ? max_items : (count + 1);
-                    SDL_Rect list = { menu_panel.x - MENU_DROPDOWN_WIDTH, subtitle_box.y, MENU_DROPDOWN_WIDTH, item_h * display_count };
-                    if (list.x < margin) list.x = margin;
-                    int max_scroll = (count + 1) > max_items ? (count + 1) - max_items : 0;
-                    if (subtitle_scroll > max_scroll) subtitle_scroll = max_scroll;
-                    if (subtitle_scroll < 0) subtitle_scroll = 0;
-                    int win_w, win_h;
-                    SDL_GetWindowSize(win, &win_w, &win_h);
-                    if (list.y + list.h > win_h) {
-                        list.y = win_h - list.h;
-                        if (list.y < margin) list.y = margin;
-                    }
-                    draw_rect(ren, list, (SDL_Color){ 26, 26, 34, (Uint8)(220 * overlay_alpha) });
-                    if (subtitle_scroll == 0) {
-                        SDL_Rect off_item = { list.x, list.y, list.w - ((count + 1) > max_items ? MENU_DROPDOWN_SCROLLBAR_WIDTH : 0), item_h };
-                        if (vr->current_subtitle < 0) draw_rect(ren, off_item, (SDL_Color){ 40, 80, 120, (Uint8)(180 * overlay_alpha) });
-                        draw_text_shadow(ren, off_item.x + MENU_DROPDOWN_TEXT_PADDING_X, off_item.y + MENU_DROPDOWN_TEXT_PADDING_Y, "Subtitles: Off", text);
-                        for (int i = 1; i < display_count; i++) {
-                            int idx = (subtitle_scroll + i) - 1;
-                            if (idx >= 0 && idx < count) {
-                                SDL_Rect item = { list.x, list.y + i * item_h, list.w - ((count + 1) > max_items ? MENU_DROPDOWN_SCROLLBAR_WIDTH : 0), item_h };
-                                if (vr->current_subtitle == idx) draw_rect(ren, item, (SDL_Color){ 40, 80, 120, (Uint8)(180 * overlay_alpha) });
-                                draw_text_shadow(ren, item.x + MENU_DROPDOWN_TEXT_PADDING_X, item.y + MENU_DROPDOWN_TEXT_PADDING_Y, vr_get_subtitle_track_name(vr, idx), text);
-                            }
-                        }
+            if (!retained || !overlay_valid || memcmp(&key, &overlay_key, sizeof(key)) != 0) {
+                float draw_alpha = retained ? 1.0f : overlay_alpha;
+                if (retained) {
+                    text_flush(ren);
+                    SDL_SetRenderTarget(ren, overlay_tex);
+                    SDL_SetRenderDrawColor(ren, 0, 0, 0, 0);
+                    SDL_RenderClear(ren);
+                }
+                SDL_SetRenderDrawBlendMode(ren, SDL_BLENDMODE_BLEND);
+
+                SDL_Color panel = { 20, 20, 24, (Uint8)(200 * draw_alpha) };
+                SDL_Color text = { 230, 230, 235, (Uint8)(255 * draw_alpha) };
+                SDL_Color accent = { 68, 160, 255, (Uint8)(230 * draw_alpha) };
+                SDL_Color muted = { 120, 120, 130, (Uint8)(200 * draw_alpha) };
+
+                draw_rect(ren, overlay_rect, panel);
+
+                SDL_Rect base = timeline_rect;
+                base.h = 6;
+                draw_rect(ren, base, (SDL_Color){ 70, 70, 80, (Uint8)(180 * draw_alpha) });
+                SDL_Rect fill = { base.x, base.y, (int)(base.w * t), base.h };
+                draw_rect(ren, fill, accent);
+                SDL_Rect handle = { base.x + (int)(base.w * t) - 6, base.y - 4, 12, 12 };
+                draw_rect(ren, handle, (SDL_Color){ 220, 220, 230, (Uint8)(220 * draw_alpha) });
+
+                char left_time[32];
+                char right_time[32];
+                format_time(cur, left_time, sizeof(left_time));
+                format_time(dur, right_time, sizeof(right_time));
+                draw_text_shadow(ren, margin, h - overlay_h + 24, left_time, text);
+                int right_w = 0, right_h = 0;
+                TTF_SizeUTF8(ui_font, right_time, &right_w, &right_h);
+                draw_text_shadow(ren, w - margin - right_w - 40, h - overlay_h + 24, right_time, text);
+
+                draw_rect(ren, volume_rect, (SDL_Color){ 70, 70, 80, (Uint8)(180 * draw_alpha) });
+                float vol_t = clampf(volume_percent / 200.0f, 0.0f, 1.0f);
+                SDL_Rect vol_fill = { volume_rect.x, volume_rect.y + (int)(volume_rect.h * (1.0f - vol_t)), volume_rect.w, (int)(volume_rect.h * vol_t) };
+                draw_rect(ren, vol_fill, accent);
+                char vol_text[32];
+                snprintf(vol_text, sizeof(vol_text), "%d%%", (int)volume_percent);
+                draw_text_shadow(ren, volume_rect.x - 28, volume_rect.y + volume_rect.h + 6, vol_text, muted);
+
+                draw_rect(ren, hamburger, (SDL_Color){ 35, 35, 45, (Uint8)(200 * draw_alpha) });
+                draw_text_shadow(ren, hamburger.x + 6, hamburger.y + 2, "≡", text);
+
+                if (menu_open) {
+                    draw_rect(ren, menu_panel, (SDL_Color){ 28, 28, 36, (Uint8)(220 * draw_alpha) });
+                    draw_rect(ren, audio_box, (SDL_Color){ 35, 35, 45, (Uint8)(200 * draw_alpha) });
+                    draw_rect(ren, subtitle_box, (SDL_Color){ 35, 35, 45, (Uint8)(200 * draw_alpha) });
+                    draw_rect(ren, font_box, (SDL_Color){ 35, 35, 45, (Uint8)(200 * draw_alpha) });
+                    draw_rect(ren, playback_box, (SDL_Color){ 35, 35, 45, (Uint8)(200 * draw_alpha) });
+
+                    char audio_label[160];
+                    if (vr && vr_get_audio_track_count(vr) > 0) {
+                        snprintf(audio_label, sizeof(audio_label), "Audio: %s", vr_get_audio_track_name(vr, vr->current_audio));
                     } else {
+                        snprintf(audio_label, sizeof(audio_label), "Audio");
+                    }
+                    const char* sub_name = (vr && vr_get_subtitle_track_count(vr) > 0 && vr->current_subtitle >= 0) ? vr_get_subtitle_track_name(vr, vr->current_subtitle) : "Subtitles: Off";
+                    char font_label[160];
+                    snprintf(font_label, sizeof(font_label), "Font: %s", ui_font_label);
+                    char playback_label[160];
+                    char tmp[64];
+                    snprintf(tmp, sizeof(tmp), "%.6f", playback_speed);
+                    char *dot = strchr(tmp, '.');
+                    char *end = tmp + strlen(tmp) - 1;
+                    while (end > dot + 1 && *end == '0') *end-- = '\0';
+                    snprintf(playback_label, sizeof(playback_label), "Speed: %sx", tmp);
+                    draw_text_shadow(ren, audio_box.x + 8, audio_box.y + 3, audio_label, text);
+                    draw_text_shadow(ren, subtitle_box.x + 8, subtitle_box.y + 3, sub_name, text);
+                    draw_text_shadow(ren, font_box.x + 8, font_box.y + 3, font_label, text);
+                    draw_text_shadow(ren, playback_box.x + 8, playback_box.y + 3, playback_label, text);
+
+                    if (audio_menu_open && vr) {
+                        int count = vr_get_audio_track_count(vr);
+                        int max_items = MENU_MAX_VISIBLE_ITEMS;
+                        int item_h = MENU_DROPDOWN_ITEM_HEIGHT;
+                        int display_count = count > max_items ? max_items : count;
+                        SDL_Rect list = { menu_panel.x - MENU_DROPDOWN_WIDTH, audio_box.y, MENU_DROPDOWN_WIDTH, item_h * display_count };
+                        if (list.x < margin) list.x = margin;
+                        
+                        int max_scroll = count > max_items ? count - max_items : 0;
+                        if (audio_scroll > max_scroll) audio_scroll = max_scroll;
+                        if (audio_scroll < 0) audio_scroll = 0;
+                        
+                        draw_rect(ren, list, (SDL_Color){ 26, 26, 34, (Uint8)(220 * draw_alpha) });
                         for (int i = 0; i < display_count; i++) {
-                            int idx = (subtitle_scroll + i) - 1;
-                            if (idx >= 0 && idx < count) {
-                                SDL_Rect item = { list.x, list.y + i * item_h, list.w - ((count + 1) > max_items ? MENU_DROPDOWN_SCROLLBAR_WIDTH : 0), item_h };
-                                if (vr->current_subtitle == idx) draw_rect(ren, item, (SDL_Color){ 40, 80, 120, (Uint8)(180 * overlay_alpha) });
-                                draw_text_shadow(ren, item.x + MENU_DROPDOWN_TEXT_PADDING_X, item.y + MENU_DROPDOWN_TEXT_PADDING_Y, vr_get_subtitle_track_name(vr, idx), text);
-                            }
+                            int idx = audio_scroll + i;
+                            SDL_Rect item = { list.x, list.y + i * item_h, list.w - (count > max_items ? MENU_DROPDOWN_SCROLLBAR_WIDTH : 0), item_h };
+                            if (vr->current_audio == idx) draw_rect(ren, item, (SDL_Color){ 40, 80, 120, (Uint8)(180 * draw_alpha) });
+                            draw_text_shadow(ren, item.x + MENU_DROPDOWN_TEXT_PADDING_X, item.y + MENU_DROPDOWN_TEXT_PADDING_Y, vr_get_audio_track_name(vr, idx), text);
+                        }
+                        
+                        if (count > max_items) {
+                            SDL_Rect scrollbar_bg = { list.x + list.w - MENU_DROPDOWN_SCROLLBAR_WIDTH, list.y, MENU_DROPDOWN_SCROLLBAR_WIDTH, list.h };
+                            draw_rect(ren, scrollbar_bg, (SDL_Color){ 35, 35, 45, (Uint8)(200 * draw_alpha) });
+                            int scroll_h = (max_items * list.h) / count;
+                            int scroll_y = list.y + (audio_scroll * list.h) / count;
+                            SDL_Rect scrollbar = { list.x + list.w - MENU_DROPDOWN_SCROLLBAR_WIDTH, scroll_y, MENU_DROPDOWN_SCROLLBAR_WIDTH, scroll_h };
+                            draw_rect(ren, scrollbar, (SDL_Color){ 80, 80, 100, (Uint8)(220 * draw_alpha) });
                         }
                     }
-                    if ((count + 1) > max_items) {
-                        SDL_Rect scrollbar_bg = { list.x + list.w - MENU_DROPDOWN_SCROLLBAR_WIDTH, list.y, MENU_DROPDOWN_SCROLLBAR_WIDTH, list.h };
-                        draw_rect(ren, scrollbar_bg, (SDL_Color){ 35, 35, 45, (Uint8)(200 * overlay_alpha) });
-                        int scroll_h = (max_items * list.h) / (count + 1);
-                        int scroll_y = list.y + (subtitle_scroll * list.h) / (count + 1);
-                        SDL_Rect scrollbar = { list.x + list.w - MENU_DROPDOWN_SCROLLBAR_WIDTH, scroll_y, MENU_DROPDOWN_SCROLLBAR_WIDTH, scroll_h };
-                        draw_rect(ren, scrollbar, (SDL_Color){ 80, 80, 100, (Uint8)(220 * overlay_alpha) });
+
+                    if (subtitle_menu_open && vr) {
+                        int count = vr_get_subtitle_track_count(vr);
+                        int max_items = MENU_MAX_VISIBLE_ITEMS;
+                        int item_h = MENU_DROPDOWN_ITEM_HEIGHT;
+                        int display_count = (count + 1) > max_items ? max_items : (count + 1);
+                        SDL_Rect list = { menu_panel.x - MENU_DROPDOWN_WIDTH, subtitle_box.y, MENU_DROPDOWN_WIDTH, item_h * display_count };
+                        if (list.x < margin) list.x = margin;
+                        int max_scroll = (count + 1) > max_items ? (count + 1) - max_items : 0;
+                        if (subtitle_scroll > max_scroll) subtitle_scroll = max_scroll;
+                        if (subtitle_scroll < 0) subtitle_scroll = 0;
+                        if (list.y + list.h > h) {
+                            list.y = h - list.h;
+                            if (list.y < margin) list.y = margin;
+                        }
+                        draw_rect(ren, list, (SDL_Color){ 26, 26, 34, (Uint8)(220 * draw_alpha) });
+                        if (subtitle_scroll == 0) {
+                            SDL_Rect off_item = { list.x, list.y, list.w - ((count + 1) > max_items ? MENU_DROPDOWN_SCROLLBAR_WIDTH : 0), item_h };
+                            if (vr->current_subtitle < 0) draw_rect(ren, off_item, (SDL_Color){ 40, 80, 120, (Uint8)(180 * draw_alpha) });
+                            draw_text_shadow(ren, off_item.x + MENU_DROPDOWN_TEXT_PADDING_X, off_item.y + MENU_DROPDOWN_TEXT_PADDING_Y, "Subtitles: Off", text);
+                            for (int i = 1; i < display_count; i++) {
+                                int idx = (subtitle_scroll + i) - 1;
+                                if (idx >= 0 && idx < count) {
+                                    SDL_Rect item = { list.x, list.y + i * item_h, list.w - ((count + 1) > max_items ? MENU_DROPDOWN_SCROLLBAR_WIDTH : 0), item_h };
+                                    if (vr->current_subtitle == idx) draw_rect(ren, item, (SDL_Color){ 40, 80, 120, (Uint8)(180 * draw_alpha) });
+                                    draw_text_shadow(ren, item.x + MENU_DROPDOWN_TEXT_PADDING_X, item.y + MENU_DROPDOWN_TEXT_PADDING_Y, vr_get_subtitle_track_name(vr, idx), text);
+                                }
+                            }
+                        } else {
+                            for (int i = 0; i < display_count; i++) {
+                                int idx = (subtitle_scroll + i) - 1;
+                                if (idx >= 0 && idx < count) {
+                                    SDL_Rect item = { list.x, list.y + i * item_h, list.w - ((count + 1) > max_items ? MENU_DROPDOWN_SCROLLBAR_WIDTH : 0), item_h };
+                                    if (vr->current_subtitle == idx) draw_rect(ren, item, (SDL_Color){ 40, 80, 120, (Uint8)(180 * draw_alpha) });
+                                    draw_text_shadow(ren, item.x + MENU_DROPDOWN_TEXT_PADDING_X, item.y + MENU_DROPDOWN_TEXT_PADDING_Y, vr_get_subtitle_track_name(vr, idx), text);
+                                }
+                            }
+                        }
+                        if ((count + 1) > max_items) {
+                            SDL_Rect scrollbar_bg = { list.x + list.w - MENU_DROPDOWN_SCROLLBAR_WIDTH, list.y, MENU_DROPDOWN_SCROLLBAR_WIDTH, list.h };
+                            draw_rect(ren, scrollbar_bg, (SDL_Color){ 35, 35, 45, (Uint8)(200 * draw_alpha) });
+                            int scroll_h = (max_items * list.h) / (count + 1);
+                            int scroll_y = list.y + (subtitle_scroll * list.h) / (count + 1);
+                            SDL_Rect scrollbar = { list.x + list.w - MENU_DROPDOWN_SCROLLBAR_WIDTH, scroll_y, MENU_DROPDOWN_SCROLLBAR_WIDTH, scroll_h };
+                            draw_rect(ren, scrollbar, (SDL_Color){ 80, 80, 100, (Uint8)(220 * draw_alpha) });
+                        }
                     }
-                }
 
-                if (font_menu_open) {
-                    int count = default_font_count + 1;
-                    int item_h = MENU_DROPDOWN_ITEM_HEIGHT;
+                    if (font_menu_open) {
+                        int count = default_font_count + 1;
+                        int item_h = MENU_DROPDOWN_ITEM_HEIGHT;
+
+                        SDL_Rect list = {
+                            menu_panel.x - MENU_DROPDOWN_WIDTH,
+                            font_box.y,
+                            MENU_DROPDOWN_WIDTH,
+                            item_h * count
+                        };
 
-                    SDL_Rect list = {
-                        menu_panel.x - MENU_DROPDOWN_WIDTH,
-                        font_box.y,
-                        MENU_DROPDOWN_WIDTH,
-                        item_h * count
-                    };
+                        if (list.x < margin) list.x = margin;
 
-                    if (list.x < margin) list.x = margin;
+                        draw_rect(ren, list, (SDL_Color){26,26,34,(Uint8)(220*draw_alpha)});
 
-                    draw_rect(ren, list, (SDL_Color){26,26,34,(Uint8)(220*overlay_alpha)});
+                        for (int i = 0; i < default_font_count; ++i) {
+                            draw_text_shadow(
+                                ren,
+                                list.x + MENU_DROPDOWN_TEXT_PADDING_X,
+                                list.y + MENU_DROPDOWN_TEXT_PADDING_Y + item_h * i,
+                                default_fonts[i].name,
+                                text
+                            );
+                        }
 
-                    for (int i = 0; i < default_font_count; ++i) {
                         draw_text_shadow(
                             ren,
                             list.x + MENU_DROPDOWN_TEXT_PADDING_X,
-                            list.y + MENU_DROPDOWN_TEXT_PADDING_Y + item_h * i,
-                            default_fonts[i].name,
+                            list.y + MENU_DROPDOWN_TEXT_PADDING_Y + item_h * default_font_count,
+                            "Custom...",
                             text
                         );
                     }
 
-                    draw_text_shadow(
-                        ren,
-                        list.x + MENU_DROPDOWN_TEXT_PADDING_X,
-                        list.y + MENU_DROPDOWN_TEXT_PADDING_Y + item_h * default_font_count,
-                        "Custom...",
-                        text
-                    );
-                }
-
-                if (playback_menu_open) {
-                    int count = 8;
-                    int item_h = MENU_DROPDOWN_ITEM_HEIGHT;
-                    SDL_Rect list = { menu_panel.x - MENU_DROPDOWN_WIDTH, playback_box.y, MENU_DROPDOWN_WIDTH, item_h * count };
-                    if (list.x < margin) list.x = margin;
-                    if (list.y + list.h > h) {
-                        list.y = h - list.h;
-                        if (list.y < 0) list.y = 0;
+                    if (playback_menu_open) {
+                        int count = 8;
+                        int item_h = MENU_DROPDOWN_ITEM_HEIGHT;
+                        SDL_Rect list = { menu_panel.x - MENU_DROPDOWN_WIDTH, playback_box.y, MENU_DROPDOWN_WIDTH, item_h * count };
+                        if (list.x < margin) list.x = margin;
+                        if (list.y + list.h > h) {
+                            list.y = h - list.h;
+                            if (list.y < 0) list.y = 0;
+                        }
+                        draw_rect(ren, list, (SDL_Color){ 26, 26, 34, (Uint8)(220 * draw_alpha) });
+                        draw_text_shadow(ren, list.x + MENU_DROPDOWN_TEXT_PADDING_X, list.y + MENU_DROPDOWN_TEXT_PADDING_Y, "0.5x", text);
+                        draw_text_shadow(ren, list.x + MENU_DROPDOWN_TEXT_PADDING_X, list.y + MENU_DROPDOWN_TEXT_PADDING_Y + item_h, "0.75x", text);
+                        draw_text_shadow(ren, list.x + MENU_DROPDOWN_TEXT_PADDING_X, list.y + MENU_DROPDOWN_TEXT_PADDING_Y + item_h * 2, "1.0x (Normal)", text);
+                        draw_text_shadow(ren, list.x + MENU_DROPDOWN_TEXT_PADDING_X, list.y + MENU_DROPDOWN_TEXT_PADDING_Y + item_h * 3, "1.25x", text);
+                        draw_text_shadow(ren, list.x + MENU_DROPDOWN_TEXT_PADDING_X, list.y + MENU_DROPDOWN_TEXT_PADDING_Y + item_h * 4, "1.5x", text);
+                        draw_text_shadow(ren, list.x + MENU_DROPDOWN_TEXT_PADDING_X, list.y + MENU_DROPDOWN_TEXT_PADDING_Y + item_h * 5, "2.0x", text);
+                        draw_text_shadow(ren, list.x + MENU_DROPDOWN_TEXT_PADDING_X, list.y + MENU_DROPDOWN_TEXT_PADDING_Y + item_h * 6, "3.0x", text);
+                        draw_text_shadow(ren, list.x + MENU_DROPDOWN_TEXT_PADDING_X, list.y + MENU_DROPDOWN_TEXT_PADDING_Y + item_h * 7, "5.0x", text);
                     }
-                    draw_rect(ren, list, (SDL_Color){ 26, 26, 34, (Uint8)(220 * overlay_alpha) });
-                    draw_text_shadow(ren, list.x + MENU_DROPDOWN_TEXT_PADDING_X, list.y + MENU_DROPDOWN_TEXT_PADDING_Y, "0.5x", text);
-                    draw_text_shadow(ren, list.x + MENU_DROPDOWN_TEXT_PADDING_X, list.y + MENU_DROPDOWN_TEXT_PADDING_Y + item_h, "0.75x", text);
-                    draw_text_shadow(ren, list.x + MENU_DROPDOWN_TEXT_PADDING_X, list.y + MENU_DROPDOWN_TEXT_PADDING_Y + item_h * 2, "1.0x (Normal)", text);
-                    draw_text_shadow(ren, list.x + MENU_DROPDOWN_TEXT_PADDING_X, list.y + MENU_DROPDOWN_TEXT_PADDING_Y + item_h * 3, "1.25x", text);
-                    draw_text_shadow(ren, list.x + MENU_DROPDOWN_TEXT_PADDING_X, list.y + MENU_DROPDOWN_TEXT_PADDING_Y + item_h * 4, "1.5x", text);
-                    draw_text_shadow(ren, list.x + MENU_DROPDOWN_TEXT_PADDING_X, list.y + MENU_DROPDOWN_TEXT_PADDING_Y + item_h * 5, "2.0x", text);
-                    draw_text_shadow(ren, list.x + MENU_DROPDOWN_TEXT_PADDING_X, list.y + MENU_DROPDOWN_TEXT_PADDING_Y + item_h * 6, "3.0x", text);
-                    draw_text_shadow(ren, list.x + MENU_DROPDOWN_TEXT_PADDING_X, list.y + MENU_DROPDOWN_TEXT_PADDING_Y + item_h * 7, "5.0x", text);
                 }
+                if (retained) {
+                    text_flush(ren);
+                    SDL_SetRenderTarget(ren, NULL);
+                    overlay_key = key;
+                    overlay_valid = true;
+                }
+            }
+
+            if (retained) {
+                Uint8 a = (Uint8)(255 * overlay_alpha);
+                SDL_SetTextureColorMod(overlay_tex, a, a, a);
+                SDL_SetTextureAlphaMod(overlay_tex, a);
+                SDL_RenderCopy(ren, overlay_tex, NULL, NULL);
+            }
+        }
+
+        thumb_waiting = false;
+        if (vr && overlay_alpha > 0.01f && (dragging_timeline || hover_x >= 0)) {
+            double dur = vr_get_duration(vr);
+            double at = dragging_timeline ? drag_time
+                      : clampf((float)(hover_x - timeline_rect.x) / (float)timeline_rect.w, 0.0f, 1.0f) * dur;
+            if (vr->thumbs != thumb_owner) {
+                thumb_owner = vr->thumbs;
+                thumb_tex_bucket = -1;
+            }
+            int th = dur > 0.0 ? thumb_fetch(vr->thumbs, at, ren, &thumb_tex, &thumb_tex_bucket) : -1;
+            if (th == 0) thumb_waiting = true;
+            if (th > 0) {
+                int tx = timeline_rect.x + (int)(timeline_rect.w * (at / dur)) - THUMB_WIDTH / 2;
+                if (tx > w - margin - THUMB_WIDTH) tx = w - margin - THUMB_WIDTH;
+                if (tx < margin) tx = margin;
+                SDL_Rect dst = { tx, timeline_rect.y - th - 16, THUMB_WIDTH, th };
+                SDL_Rect border = { dst.x - 2, dst.y - 2, dst.w + 4, dst.h + 4 };
+                SDL_SetRenderDrawBlendMode(ren, SDL_BLENDMODE_BLEND);
+                draw_rect(ren, border, (SDL_Color){ 20, 20, 24, (Uint8)(220 * overlay_alpha) });
+                SDL_SetTextureAlphaMod(thumb_tex, (Uint8)(255 * overlay_alpha));
+                SDL_RenderCopy(ren, thumb_tex, NULL, &dst);
+                char at_text[32];
+                format_time(at, at_text, sizeof(at_text));
+                draw_text_shadow(ren, dst.x + 6, dst.y + dst.h - 24, at_text, (SDL_Color){ 240, 240, 245, (Uint8)(255 * overlay_alpha) });
             }
         }
 
-        pause_alpha = lerpf(pause_alpha, paused ? 1.0f : 0.0f, clampf(dt * 6.0f, 0.0f, 1.0f));
         if (pause_alpha > 0.01f) {
             SDL_Color pcol = { 240, 240, 245, (Uint8)(255 * pause_alpha) };
             draw_text_shadow(ren, 20, 20, "PAUSED", pcol);
         }
 
-        Uint32 now_ticks = SDL_GetTicks();
-        if (flash_text[0]) {
-            if (now_ticks < flash_until) {
-                flash_alpha = lerpf(flash_alpha, 1.0f, clampf(dt * 8.0f, 0.0f, 1.0f));
-            } else {
-                flash_alpha = lerpf(flash_alpha, 0.0f, clampf(dt * 6.0f, 0.0f, 1.0f));
-                if (flash_alpha < 0.01f) flash_text[0] = 0;
-            }
-            if (flash_alpha > 0.01f) {
-                SDL_Color fcol = { 240, 240, 245, (Uint8)(220 * flash_alpha) };
-                draw_text_shadow(ren, 20, 56, flash_text, fcol);
-            }
+        if (flash_text[0] && flash_alpha > 0.01f) {
+            SDL_Color fcol = { 240, 240, 245, (Uint8)(220 * flash_alpha) };
+            draw_text_shadow(ren, 20, 56, flash_text, fcol);
         }
 
         if (vr && playback_speed > 2.0f) {
@@ -1334,7 +1737,13 @@ int main(int argc, char** argv) {
             draw_text_shadow(ren, 20, 92, "Audio disabled at high speed", acol);
         }
 
+        if (show_stats) draw_stats(ren, w, &presenter, vr);
+
+        text_flush(ren);
         SDL_RenderPresent(ren);
+        present_mark(&presenter, new_frame, vr ? vr_get_video_time(vr) : 0.0, media_rate);
+        if (new_frame) vr_note_presented(vr);
+        text_cache_trim();
     }
 
     #if SAVE_FILE
@@ -1343,6 +1752,10 @@ int main(int argc, char** argv) {
         memcpy(save_state.recent_files, recent_files, sizeof(char*) * recent_count);
     #endif
     if (vr) vr_free(vr);
+    text_cache_clear();
+    text_atlas_free();
+    if (overlay_tex) SDL_DestroyTexture(overlay_tex);
+    if (thumb_tex) SDL_DestroyTexture(thumb_tex);
     if (ui_font) TTF_CloseFont(ui_font);
     TTF_Quit();
     for (int i = 0; i < recent_count; i++) free(recent_files[i]);
@@ -0,0 +1,249 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../thirdparty/SDL2/SDL.h"
+#include "../thirdparty/libavcodec/avcodec.h"
+#include "../thirdparty/libavutil/imgutils.h"
+#include "../thirdparty/libavutil/pixdesc.h"
+#include "../thirdparty/libavutil/samplefmt.h"
+#include "../thirdparty/libavutil/mem.h"
+#if FRAME_POOL_HUGE_PAGES && defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#define FRAME_POOL_ALIGN 64
+#define FRAME_POOL_HUGE_PAGE (2 * 1024 * 1024)
+#define FRAME_POOL_HUGE_MIN_BYTES FRAME_POOL_HUGE_PAGE
+
+enum { FRAME_POOL_VIDEO, FRAME_POOL_AUDIO, FRAME_POOL_KINDS };
+
+typedef struct {
+    SDL_atomic_t allocs;   /* buffers ever allocated */
+    SDL_atomic_t gets;     /* buffers handed to a decoder */
+    SDL_atomic_t live;     /* buffers currently allocated */
+    SDL_atomic_t live_kb;
+} FramePoolStats;
+
+static FramePoolStats frame_pool_stats[FRAME_POOL_KINDS];
+
+/* Decoder frame buffers come from AVBufferPools sized for the current stream
+ * geometry, so steady-state decoding never reaches the allocator. Decoders
+ * may call in from their own threads, hence the lock around reconfiguring. */
+typedef struct {
+    SDL_mutex* lock;
+    int kind;
+    int format;
+    int width;
+    int height;
+    int channels;
+    int nb_samples;
+    int linesize[4];
+    AVBufferPool* pools[4];
+} FramePool;
+
+/* Sits in the FRAME_POOL_ALIGN bytes just before each buffer's data. */
+typedef struct {
+    uint8_t* base;   /* what av_malloc or mmap returned */
+    size_t size;
+    size_t map_size;
+    int mapped;
+} FramePoolHeader;
+
+static uint8_t* frame_pool_align_up(uint8_t* p, uintptr_t align) {
+    return (uint8_t*)(((uintptr_t)p + align - 1) & ~(align - 1));
+}
+
+static void frame_pool_release(void* opaque, uint8_t* data) {
+    FramePoolStats* st = (FramePoolStats*)opaque;
+    FramePoolHeader* hdr = (FramePoolHeader*)(data - FRAME_POOL_ALIGN);
+    SDL_AtomicAdd(&st->live_kb, -(int)(hdr->size / 1024));
+    SDL_AtomicAdd(&st->live, -1);
+    budget_add(BUDGET_FRAMES, -(int64_t)hdr->size);
+#if FRAME_POOL_HUGE_PAGES && defined(__linux__)
+    if (hdr->mapped) {
+        munmap(hdr->base, hdr->map_size);
+        return;
+    }
+#endif
+    av_free(hdr->base);
+}
+
+/* Every buffer's data starts on a FRAME_POOL_ALIGN boundary with its header
+ * just in front. Large surfaces are mapped on their own, over-mapped by a
+ * huge page so the data can start on a 2 MiB boundary, and advised onto
+ * transparent huge pages; the unused head and tail are never touched. */
+static AVBufferRef* frame_pool_alloc(void* opaque, size_t size) {
+    FramePoolStats* st = (FramePoolStats*)opaque;
+    uint8_t* base = NULL;
+    uint8_t* data = NULL;
+    size_t map_size = 0;
+    int mapped = 0;
+#if FRAME_POOL_HUGE_PAGES && defined(__linux__)
+    if (size >= FRAME_POOL_HUGE_MIN_BYTES) {
+        map_size = size + FRAME_POOL_HUGE_PAGE;
+        void* m = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (m != MAP_FAILED) {
+            base = (uint8_t*)m;
+            data = frame_pool_align_up(base + FRAME_POOL_ALIGN, FRAME_POOL_HUGE_PAGE);
+            madvise(data, size, MADV_HUGEPAGE);
+            mapped = 1;
+        }
+    }
+#endif
+    if (!data) {
+        base = (uint8_t*)av_malloc(size + 2 * FRAME_POOL_ALIGN - 1);
+        if (!base) return NULL;
+        data = frame_pool_align_up(base + FRAME_POOL_ALIGN, FRAME_POOL_ALIGN);
+    }
+    FramePoolHeader* hdr = (FramePoolHeader*)(data - FRAME_POOL_ALIGN);
+    hdr->base = base;
+    hdr->size = size;
+    hdr->map_size = map_size;
+    hdr->mapped = mapped;
+    SDL_AtomicAdd(&st->allocs, 1);
+    SDL_AtomicAdd(&st->live, 1);
+    SDL_AtomicAdd(&st->live_kb, (int)(size / 1024));
+    budget_add(BUDGET_FRAMES, (int64_t)size);
+
+    AVBufferRef* buf = av_buffer_create(data, size, frame_pool_release, st, 0);
+    if (!buf) frame_pool_release(st, data);
+    return buf;
+}
+
+static void frame_pool_reset(FramePool* fp) {
+    for (int i = 0; i < 4; i++) av_buffer_pool_uninit(&fp->pools[i]);
+    memset(fp->linesize, 0, sizeof(fp->linesize));
+    fp->format = -1;
+    fp->width = fp->height = 0;
+    fp->channels = fp->nb_samples = 0;
+}
+
+static int frame_pool_setup_video(FramePool* fp, AVCodecContext* ctx, AVFrame* frame) {
+    int w = frame->width, h = frame->height;
+    int align[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2(ctx, &w, &h, align);
+    int linesize[4];
+    if (av_image_fill_linesizes(linesize, frame->format, w) < 0) return 0;
+    ptrdiff_t strides[4];
+    for (int i = 0; i < 4; i++) {
+        linesize[i] = FFALIGN(linesize[i], FRAME_POOL_ALIGN);
+        strides[i] = linesize[i];
+    }
+    size_t sizes[4];
+    if (av_image_fill_plane_sizes(sizes, frame->format, h, strides) < 0) return 0;
+
+    frame_pool_reset(fp);
+    for (int i = 0; i < 4 && sizes[i] > 0; i++) {
+        /* decoders may read up to 16 bytes past the end of a plane */
+        fp->pools[i] = av_buffer_pool_init2(sizes[i] + 16,
+                                            &frame_pool_stats[fp->kind], frame_pool_alloc, NULL);
+        if (!fp->pools[i]) return 0;
+    }
+    memcpy(fp->linesize, linesize, sizeof(linesize));
+    fp->format = frame->format;
+    fp->width = frame->width;
+    fp->height = frame->height;
+    return 1;
+}
+
+static int frame_pool_setup_audio(FramePool* fp, AVFrame* frame) {
+    int channels = frame->ch_layout.nb_channels;
+    int linesize = 0;
+    if (av_samples_get_buffer_size(&linesize, channels, frame->nb_samples, frame->format, 0) < 0) return 0;
+
+    frame_pool_reset(fp);
+    fp->pools[0] = av_buffer_pool_init2((size_t)linesize, &frame_pool_stats[fp->kind], frame_pool_alloc, NULL);
+    if (!fp->pools[0]) return 0;
+    fp->linesize[0] = linesize;
+    fp->format = frame->format;
+    fp->channels = channels;
+    fp->nb_samples = frame->nb_samples;
+    return 1;
+}
+
+static int frame_pool_get_buffer(AVCodecContext* ctx, AVFrame* frame, int flags) {
+    FramePool* fp = (FramePool*)ctx->opaque;
+    int video = ctx->codec_type == AVMEDIA_TYPE_VIDEO;
+    int planes;
+    if (video) {
+        const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(frame->format);
+        if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL)))
+            return avcodec_default_get_buffer2(ctx, frame, flags);
+        planes = av_pix_fmt_count_planes(frame->format);
+    } else {
+        planes = av_sample_fmt_is_planar(frame->format) ? frame->ch_layout.nb_channels : 1;
+        if (planes > AV_NUM_DATA_POINTERS) return avcodec_default_get_buffer2(ctx, frame, flags);
+    }
+
+    SDL_LockMutex(fp->lock);
+    int ok = 1;
+    if (video) {
+        if (fp->format != frame->format || fp->width != frame->width || fp->height != frame->height)
+            ok = frame_pool_setup_video(fp, ctx, frame);
+    } else {
+        if (fp->format != frame->format || fp->channels != frame->ch_layout.nb_channels
+            || frame->nb_samples > fp->nb_samples)
+            ok = frame_pool_setup_audio(fp, frame);
+    }
+    for (int i = 0; ok && i < planes; i++) {
+        AVBufferPool* pool = video ? fp->pools[i] : fp->pools[0];
+        frame->buf[i] = pool ? av_buffer_pool_get(pool) : NULL;
+        if (!frame->buf[i]) { ok = 0; break; }
+        frame->data[i] = frame->buf[i]->data;
+        SDL_AtomicAdd(&frame_pool_stats[fp->kind].gets, 1);
+    }
+    if (ok) {
+        if (video) {
+            for (int i = 0; i < 4; i++) frame->linesize[i] = fp->linesize[i];
+        } else {
+            av_samples_get_buffer_size(&frame->linesize[0], frame->ch_layout.nb_channels,
+                                       frame->nb_samples, frame->format, 0);
+        }
+    }
+    SDL_UnlockMutex(fp->lock);
+
+    if (!ok) {
+        for (int i = 0; i < AV_NUM_DATA_POINTERS; i++) av_buffer_unref(&frame->buf[i]);
+        memset(frame->data, 0, sizeof(frame->data));
+        return AVERROR(ENOMEM);
+    }
+    frame->extended_data = frame->data;
+    return 0;
+}
+
+/* Call before avcodec_open2. Codecs that cannot decode into caller buffers
+ * keep the default allocator. */
+static void frame_pool_attach(AVCodecContext* ctx) {
+    if (!ctx->codec || !(ctx->codec->capabilities & AV_CODEC_CAP_DR1)) return;
+    if (ctx->codec_type != AVMEDIA_TYPE_VIDEO && ctx->codec_type != AVMEDIA_TYPE_AUDIO) return;
+    FramePool* fp = (FramePool*)calloc(1, sizeof(FramePool));
+    if (!fp) return;
+    fp->lock = SDL_CreateMutex();
+    fp->kind = ctx->codec_type == AVMEDIA_TYPE_VIDEO ? FRAME_POOL_VIDEO : FRAME_POOL_AUDIO;
+    fp->format = -1;
+    ctx->opaque = fp;
+    ctx->get_buffer2 = frame_pool_get_buffer;
+}
+
+/* Frees the codec context and its pool. Frames still holding pool buffers
+ * keep the underlying pools alive until they are released. */
+static void frame_pool_free_context(AVCodecContext** ctx) {
+    if (!ctx || !*ctx) return;
+    FramePool* fp = (*ctx)->get_buffer2 == frame_pool_get_buffer ? (FramePool*)(*ctx)->opaque : NULL;
+    avcodec_free_context(ctx);
+    if (fp) {
+        frame_pool_reset(fp);
+        SDL_DestroyMutex(fp->lock);
+        free(fp);
+    }
+}
+
+/* Frees the buffers the pool is holding for reuse, so memory a released
+ * frame cache had pinned goes back to the system. The next frame sets the
+ * pool up again; buffers still referenced are freed when released. */
+static void frame_pool_trim(AVCodecContext* ctx) {
+    if (!ctx || ctx->get_buffer2 != frame_pool_get_buffer) return;
+    FramePool* fp = (FramePool*)ctx->opaque;
+    SDL_LockMutex(fp->lock);
+    frame_pool_reset(fp);
+    SDL_UnlockMutex(fp->lock);
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "../thirdparty/nob.h"
+#include "../thirdparty/SDL2/SDL.h"
+
+#define PRESENT_DEFAULT_REFRESH_HZ 60.0
+#define PRESENT_SLACK_SEC 0.001
+#define PRESENT_CADENCE_BUCKETS 6
+
+/* Decides when a decoded frame goes to the screen. Vsync instants are
+ * predicted from the display refresh interval and the time the last
+ * SDL_RenderPresent returned; a frame is shown on the vsync nearest to its
+ * due time, so 23.976 fps on 60 Hz settles into an even 3:2 cadence. All
+ * times are seconds on the SDL performance counter. */
+typedef struct {
+    Uint64 origin;
+    double freq;
+    double refresh_hz;
+    double interval;
+    double measured_interval;
+    int measured_samples;
+    double last_vsync;
+
+    double frame_shown_at;
+    double frame_pts;
+    int frame_valid;
+
+    Uint64 frames;
+    Uint64 late;
+    Uint64 dropped;
+    Uint64 cadence[PRESENT_CADENCE_BUCKETS]; /* frames held for 1..N vsyncs, last bucket is N or more */
+    Uint64 judder_samples;
+    double judder_avg_ms;
+    double judder_max_ms;
+} Presenter;
+
+static double present_now(Presenter* ps) {
+    return (double)(SDL_GetPerformanceCounter() - ps->origin) / ps->freq;
+}
+
+static void present_update_refresh(Presenter* ps, SDL_Window* win) {
+    SDL_DisplayMode mode;
+    double hz = PRESENT_DEFAULT_REFRESH_HZ;
+    if (SDL_GetWindowDisplayMode(win, &mode) == 0 && mode.refresh_rate > 0) hz = mode.refresh_rate;
+    /* SDL reports integer rates; 59/23/29 are really the NTSC 1000/1001 variants */
+    if (hz == 23 || hz == 29 || hz == 59 || hz == 119) hz = (hz + 1) * 1000.0 / 1001.0;
+    if (hz != ps->refresh_hz) {
+        ps->refresh_hz = hz;
+        ps->interval = 1.0 / hz;
+        ps->measured_interval = ps->interval;
+        ps->measured_samples = 0;
+        nob_log(NOB_INFO, "Display refresh rate: %.3f Hz", hz);
+    }
+}
+
+static void present_init(Presenter* ps, SDL_Window* win) {
+    memset(ps, 0, sizeof(*ps));
+    ps->origin = SDL_GetPerformanceCounter();
+    ps->freq = (double)SDL_GetPerformanceFrequency();
+    present_update_refresh(ps, win);
+}
+
+static double present_interval(Presenter* ps) {
+    return ps->measured_samples >= 30 ? ps->measured_interval : ps->interval;
+}
+
+/* Returns the time the frame has to be submitted so that it is on screen at
+ * the vsync closest to `due`. Submitting any time during the interval before
+ * that vsync is enough since SDL_RenderPresent waits for it. */
+static double present_submit_time(Presenter* ps, double due) {
+    double interval = present_interval(ps);
+    double now = present_now(ps);
+    if (ps->last_vsync <= 0.0) return due;
+    double k = floor((due - ps->last_vsync) / interval + 0.5);
+    double next = floor((now - ps->last_vsync) / interval) + 1.0;
+    if (k < next) k = next;
+    return ps->last_vsync + (k - 1.0) * interval;
+}
+
+static int present_is_due(Presenter* ps, double due) {
+    return present_submit_time(ps, due) <= present_now(ps) + PRESENT_SLACK_SEC;
+}
+
+/* Call right after SDL_RenderPresent. For a new video frame `pts` is its
+ * media time and `rate` how fast media time runs against the wall clock. */
+static void present_mark(Presenter* ps, int new_frame, double pts, double rate) {
+    double now = present_now(ps);
+    double nominal = ps->interval;
+    if (ps->last_vsync > 0.0) {
+        double delta = now - ps->last_vsync;
+        if (delta > nominal * 0.75 && delta < nominal * 1.25) {
+            ps->measured_interval += (delta - ps->measured_interval) * 0.05;
+            ps->measured_samples++;
+        }
+    }
+    ps->last_vsync = now;
+    if (!new_frame) return;
+
+    double ideal = rate > 0.0 ? (pts - ps->frame_pts) / rate : 0.0;
+    if (ps->frame_valid && ideal > 0.0 && ideal < 1.0) {
+        double interval = present_interval(ps);
+        double shown = now - ps->frame_shown_at;
+        int vsyncs = (int)floor(shown / interval + 0.5);
+        if (vsyncs < 1) vsyncs = 1;
+        if (vsyncs > PRESENT_CADENCE_BUCKETS) vsyncs = PRESENT_CADENCE_BUCKETS;
+        ps->cadence[vsyncs - 1]++;
+
+        double judder_ms = fabs(shown - ideal) * 1000.0;
+        if (ps->judder_samples++ == 0) ps->judder_avg_ms = judder_ms;
+        else ps->judder_avg_ms += (judder_ms - ps->judder_avg_ms) * 0.02;
+        if (judder_ms > ps->judder_max_ms) ps->judder_max_ms = judder_ms;
+        if (shown > ideal + interval) ps->late++;
+    }
+    ps->frames++;
+    ps->frame_shown_at = now;
+    ps->frame_pts = pts;
+    ps->frame_valid = 1;
+}
+
+/* Breaks the frame-to-frame chain after a pause or seek so the gap is not
+ * counted as judder. */
+static void present_restart(Presenter* ps) {
+    ps->frame_valid = 0;
+}
+
+static void present_reset_stats(Presenter* ps) {
+    ps->frame_valid = 0;
+    ps->frames = 0;
+    ps->late = 0;
+    ps->dropped = 0;
+    memset(ps->cadence, 0, sizeof(ps->cadence));
+    ps->judder_samples = 0;
+    ps->judder_avg_ms = 0.0;
+    ps->judder_max_ms = 0.0;
+}
@@ -15,18 +15,54 @@
 #include "../thirdparty/libavutil/time.h"
 #include "../thirdparty/ass/ass.h"
 
-#define VIDEO_PKT_QUEUE_CAP 128
-#define AUDIO_PKT_QUEUE_CAP 256
+#define PKT_QUEUE_INITIAL_SLOTS 64
+#define VIDEO_PKT_QUEUE_MAX_BYTES (32 * 1024 * 1024)
+#define VIDEO_PKT_QUEUE_MAX_SEC 2.0
+#define VIDEO_PKT_QUEUE_MIN_SEC 0.1
+#define AUDIO_PKT_QUEUE_MAX_BYTES (2 * 1024 * 1024)
+#define AUDIO_PKT_QUEUE_MAX_SEC 4.0
+#define AUDIO_PKT_QUEUE_MIN_SEC 1.0
 #define AUDIO_QUEUE_TARGET_SEC 0.25
-
+#define AUDIO_QUEUE_MAX_SEC 0.5
+#define AUDIO_DEVICE_SAMPLES 1024
+#define AUDIO_LOW_LATENCY_TARGET_SEC 0.03
+#define AUDIO_LOW_LATENCY_SAMPLES 256
+#define AUDIO_TARGET_DECAY_SEC 10.0
+#define AUDIO_GAIN_RAMP_SEC 0.02
+#define AUDIO_MONO_GAIN 0.70710678f /* swresample's default centre mix level, -3 dB */
+#define AV_SYNC_THRESHOLD_SEC 0.002
+#define AV_NOSYNC_THRESHOLD_SEC 0.1
+#define AV_DIFF_AVG_NB 20
+#define AV_MAX_CORRECTION 0.01
+#define ASS_CACHE_MAX_BYTES ((int64_t)128 * 1024 * 1024)
+#define ASS_CACHE_BUDGET_SHARE 0.0625
+#define SCRUB_MIN_INTERVAL_SEC (1.0 / 60.0)
+#define SCRUB_MAX_INTERVAL_SEC 0.25
+
+/* Growable ring of packets bounded by payload bytes and by duration rather
+ * than by slot count. A queue under its low-water mark may push the others
+ * past their limits (up to twice) so one stream never starves because
+ * another is full. */
 typedef struct {
     AVPacket* pkts;
     int capacity;
     int size;
     int r;
     int w;
+    int64_t bytes;
+    int64_t duration; /* in time_base units */
+    AVRational time_base;
+    int64_t default_duration; /* used for packets without a duration */
+    int64_t max_bytes;
+    double max_sec;
+    double min_sec;
 } PacketQueue;
 
+typedef enum {
+    VR_SEEK_FAST,  /* land on the keyframe at or before the target */
+    VR_SEEK_EXACT, /* decode silently from that keyframe up to the target */
+} VrSeekMode;
+
 typedef struct {
     SDL_Window* window;
     SDL_Renderer* renderer;
@@ -43,6 +79,7 @@ typedef struct {
     AVRational video_time_base;
 
     AVCodecContext* audio_ctx;
+    AVCodecContext** audio_ctxs; /* per audio track, opened on first use */
     int audio_stream_index;
     SwrContext* swr_ctx;
     SDL_AudioDeviceID audio_dev;
@@ -51,6 +88,17 @@ typedef struct {
     uint8_t* audio_buf;
     int audio_buf_size;
     float audio_volume;
+    float audio_gain;
+    float* audio_ring; /* interleaved output frames, guarded by the audio device lock */
+    int audio_ring_cap;
+    int audio_ring_read;
+    int audio_ring_size;
+    int audio_primed;  /* ring has been fed since the last clear */
+    int audio_starved; /* callback ran dry while primed, guarded by the audio device lock */
+    int audio_underruns;
+    int low_latency;
+    double audio_target; /* seconds of output kept queued, raised on underruns */
+    double audio_stable_since;
     AVRational audio_time_base;
     double audio_clock_base;
     double audio_clock_pts;
@@ -60,22 +108,29 @@ typedef struct {
     int64_t audio_samples_written;
     int audio_clock_valid;
     double last_time;
+    double av_diff_cum;
+    int av_diff_count;
+    double av_error;
+    int av_correction;
 
     AVCodecContext* subtitle_ctx;
     int subtitle_stream_index;
     ASS_Library* ass_lib;
     ASS_Renderer* ass_renderer;
     ASS_Track* ass_track;
+    SubFile* active_subfile;
+    int subfile_attached;
+    int subtitle_read_order;
 
     double playback_speed;
     double current_time;
-    Uint32 clock_start_ticks;
-    Uint32 clock_pause_ticks;
-    Uint32 clock_pause_accum;
-    int clock_paused;
-    double clock_start_time;
+    VrSeekMode seek_mode;
+    AmpClock clock;
 
     AVFrame* frame;
+    int frame_pending;
+    double frame_pending_time;
+    int eof;
     AVFrame* yuv_frame;
     uint8_t* yuv_buffer;
 
@@ -86,25 +141,103 @@ typedef struct {
 
     int* subtitle_streams;
     char** subtitle_names;
+    SubFile** subtitle_files;
     int subtitle_count;
     int current_subtitle;
 
     PacketQueue video_pktq;
-    PacketQueue audio_pktq;
-    AVPacket pending_pkt;
-    int pending_valid;
-
-    double frame_history[32];
-    int frame_history_size;
-    int frame_history_pos;
+    PacketQueue* audio_pktq;
+    PacketQueue* audio_pktqs; /* per audio track; inactive tracks keep their most recent packets */
+
+    /* Frame stepping and reverse playback work from decoded GOPs. While
+     * gop_pos >= 0 the picture comes from `gop` and the decoder is not in
+     * step with it; the seek worker fills `gop_next` with the stretch before. */
+    GopCache gop;
+    GopCache gop_next;
+    int gop_pos;
+    double gop_next_end;
+    int gop_next_ready;
+    int reversing;
+    double reverse_wall;
+    double reverse_media;
+
+    /* A-B loop, see vr_set_loop. A stream replaying from `loop` runs on past
+     * B, one loop length further per pass; vr_get_time folds that back. */
+    LoopCache loop;
+    double loop_a;
+    double loop_b;
+    double loop_half;         /* half a frame, for comparing frame times */
+    double loop_mark;         /* A picked in the UI before B, or -1 */
+    LoopMode loop_video;
+    LoopMode loop_audio;
+    int loop_frames_ok;       /* decoded frames still fit the cache */
+    int loop_video_pos;
+    double loop_video_offset;
+    int loop_draining;
+    int64_t loop_audio_pos;
+    double loop_audio_offset;
+    int64_t loop_passes;
+
+    int hidden;               /* window not visible: audio only, see vr_set_hidden */
+
+    KeyframeIndex key_index;
+    KeyIndexBuilder* key_builder;
+    ThumbWorker* thumbs;
+
+    /* Seeks run on a worker; see vr_seek. */
+    SDL_Thread* seek_thread;
+    SDL_mutex* seek_lock;
+    SDL_cond* seek_cond;
+    SDL_atomic_t seek_serial;  /* bumped per request */
+    int seek_done_serial;      /* last request the worker completed */
+    double seek_target;
+    VrSeekMode seek_target_mode;
+    int seek_target_gop;       /* request is a GOP fill, see vr_gop_request */
+    int seek_quit;
+    int seeking;               /* main thread: a request is outstanding */
+    int demux_defer_subs;      /* worker is demuxing; park subtitle packets */
+    PacketQueue subtitle_pktq;
+    int64_t seek_requests;
+    int64_t seeks_done;
+    SDL_atomic_t seek_skipped; /* frames the last seek decoded past the keyframe */
+    double seek_started;       /* clock time of the outstanding request */
+    double scrub_cost;         /* smoothed time a fast seek takes to land */
+
+    /* Resume latency, measured from vr_set_paused to the first picture shown
+     * (vr_note_presented) and to the first audio the device takes. */
+    int64_t resume_ns;
+    int resume_video_pending;
+    int resume_audio_pending;  /* guarded by the audio device lock */
+    double resume_video_ms;
+    double resume_audio_ms;
 } VideoRenderer;
 
-static void pkt_queue_init(PacketQueue* q, int capacity) {
-    q->pkts = (AVPacket*)calloc((size_t)capacity, sizeof(AVPacket));
-    q->capacity = capacity;
-    q->size = 0;
-    q->r = 0;
-    q->w = 0;
+static void vr_seek_wait(VideoRenderer* vr);
+static int SDLCALL vr_seek_worker(void* userdata);
+static void vr_seek_request(VideoRenderer* vr, double seconds, VrSeekMode mode);
+void vr_clear_loop(VideoRenderer* vr);
+
+static void pkt_queue_init(PacketQueue* q, int64_t max_bytes, double max_sec, double min_sec) {
+    memset(q, 0, sizeof(*q));
+    q->time_base = (AVRational){ 1, AV_TIME_BASE };
+    q->max_bytes = max_bytes;
+    q->max_sec = max_sec;
+    q->min_sec = min_sec;
+}
+
+/* Audio packets without a duration count one codec frame, video packets one
+ * frame at the stream's average rate. */
+static void pkt_queue_set_stream(PacketQueue* q, const AVStream* stream) {
+    const AVCodecParameters* par = stream->codecpar;
+    q->time_base = stream->time_base;
+    q->default_duration = 0;
+    if (par->codec_type == AVMEDIA_TYPE_AUDIO) {
+        if (par->frame_size > 0 && par->sample_rate > 0) {
+            q->default_duration = av_rescale_q(par->frame_size, (AVRational){ 1, par->sample_rate }, stream->time_base);
+        }
+    } else if (stream->avg_frame_rate.num > 0 && stream->avg_frame_rate.den > 0) {
+        q->default_duration = av_rescale_q(1, av_inv_q(stream->avg_frame_rate), stream->time_base);
+    }
 }
 
 static void pkt_queue_clear(PacketQueue* q) {
@@ -112,9 +245,12 @@ static void pkt_queue_clear(PacketQueue* q) {
     for (int i = 0; i < q->capacity; i++) {
         av_packet_unref(&q->pkts[i]);
     }
+    budget_add(BUDGET_PACKETS, -q->bytes);
     q->size = 0;
     q->r = 0;
     q->w = 0;
+    q->bytes = 0;
+    q->duration = 0;
 }
 
 static void pkt_queue_free(PacketQueue* q) {
@@ -125,17 +261,58 @@ static void pkt_queue_free(PacketQueue* q) {
     q->capacity = 0;
 }
 
+static int64_t pkt_queue_pkt_duration(const PacketQueue* q, const AVPacket* pkt) {
+    return pkt->duration > 0 ? pkt->duration : q->default_duration;
+}
+
+static double pkt_queue_seconds(const PacketQueue* q) {
+    return q ? (double)q->duration * av_q2d(q->time_base) : 0.0;
+}
+
+/* Fill level against the tighter of the two limits, 1.0 meaning full. */
+static double pkt_queue_fill(const PacketQueue* q) {
+    if (!q) return 0.0;
+    double by_bytes = q->max_bytes > 0 ? (double)q->bytes / (double)q->max_bytes : 0.0;
+    double by_time = q->max_sec > 0.0 ? pkt_queue_seconds(q) / q->max_sec : 0.0;
+    return by_bytes > by_time ? by_bytes : by_time;
+}
+
 static int pkt_queue_is_full(PacketQueue* q) {
-    return q && q->size >= q->capacity;
+    return q && pkt_queue_fill(q) >= 1.0;
+}
+
+static int pkt_queue_is_hungry(PacketQueue* q) {
+    return q && pkt_queue_seconds(q) < q->min_sec;
 }
 
 static int pkt_queue_is_empty(PacketQueue* q) {
     return !q || q->size == 0;
 }
 
-static int pkt_queue_push(PacketQueue* q, const AVPacket* pkt) {
-    if (!q || !pkt || pkt_queue_is_full(q)) return 0;
-    av_packet_ref(&q->pkts[q->w], pkt);
+static int pkt_queue_grow(PacketQueue* q) {
+    int cap = q->capacity ? q->capacity * 2 : PKT_QUEUE_INITIAL_SLOTS;
+    AVPacket* pkts = (AVPacket*)calloc((size_t)cap, sizeof(AVPacket));
+    if (!pkts) return 0;
+    for (int i = 0; i < q->size; i++) {
+        av_packet_move_ref(&pkts[i], &q->pkts[(q->r + i) % q->capacity]);
+    }
+    free(q->pkts);
+    q->pkts = pkts;
+    q->capacity = cap;
+    q->r = 0;
+    q->w = q->size;
+    return 1;
+}
+
+/* Takes ownership of the packet's data. */
+static int pkt_queue_push(PacketQueue* q, AVPacket* pkt) {
+    if (!q || !pkt) return 0;
+    if (q->size >= q->capacity && !pkt_queue_grow(q)) return 0;
+    AVPacket* slot = &q->pkts[q->w];
+    av_packet_move_ref(slot, pkt);
+    q->bytes += slot->size;
+    budget_add(BUDGET_PACKETS, slot->size);
+    q->duration += pkt_queue_pkt_duration(q, slot);
     q->w = (q->w + 1) % q->capacity;
     q->size++;
     return 1;
@@ -143,19 +320,58 @@ static int pkt_queue_push(PacketQueue* q, const AVPacket* pkt) {
 
 static int pkt_queue_pop(PacketQueue* q, AVPacket* out) {
     if (!q || !out || pkt_queue_is_empty(q)) return 0;
+    q->bytes -= q->pkts[q->r].size;
+    budget_add(BUDGET_PACKETS, -q->pkts[q->r].size);
+    q->duration -= pkt_queue_pkt_duration(q, &q->pkts[q->r]);
     av_packet_move_ref(out, &q->pkts[q->r]);
     q->r = (q->r + 1) % q->capacity;
     q->size--;
     return 1;
 }
 
+/* Drops packets that end at or before media time `t` (stream time minus
+ * `start_time`). */
+static void pkt_queue_drop_before(PacketQueue* q, double start_time, double t) {
+    while (!pkt_queue_is_empty(q)) {
+        const AVPacket* p = &q->pkts[q->r];
+        if (p->pts == AV_NOPTS_VALUE) break;
+        double end = (double)(p->pts + pkt_queue_pkt_duration(q, p)) * av_q2d(q->time_base) - start_time;
+        if (end > t) break;
+        AVPacket old;
+        pkt_queue_pop(q, &old);
+        av_packet_unref(&old);
+    }
+}
+
 static double vr_get_audio_queue_seconds(VideoRenderer* vr) {
     if (!vr || !vr->audio_dev || vr->audio_spec.freq <= 0) return 0.0;
-    uint32_t queued = SDL_GetQueuedAudioSize(vr->audio_dev);
-    int bytes_per_sample = (SDL_AUDIO_BITSIZE(vr->audio_spec.format) / 8) * (int)vr->audio_spec.channels;
-    if (bytes_per_sample <= 0) return 0.0;
-    int queued_samples = (int)(queued / bytes_per_sample);
-    return (double)queued_samples / (double)vr->audio_spec.freq;
+    SDL_LockAudioDevice(vr->audio_dev);
+    int queued = vr->audio_ring_size;
+    SDL_UnlockAudioDevice(vr->audio_dev);
+    return (double)queued / (double)vr->audio_spec.freq;
+}
+
+static void vr_clear_audio(VideoRenderer* vr) {
+    if (!vr || !vr->audio_dev) return;
+    SDL_LockAudioDevice(vr->audio_dev);
+    vr->audio_ring_read = 0;
+    vr->audio_ring_size = 0;
+    vr->audio_primed = 0;
+    vr->audio_starved = 0;
+    SDL_UnlockAudioDevice(vr->audio_dev);
+}
+
+static void vr_close_audio_output(VideoRenderer* vr) {
+    if (vr->audio_dev) {
+        SDL_CloseAudioDevice(vr->audio_dev);
+        vr->audio_dev = 0;
+    }
+    free(vr->audio_ring);
+    budget_set(BUDGET_AUDIO, 0);
+    vr->audio_ring = NULL;
+    vr->audio_ring_cap = 0;
+    vr->audio_ring_read = 0;
+    vr->audio_ring_size = 0;
 }
 
 static double vr_get_audio_clock(VideoRenderer* vr) {
@@ -167,13 +383,17 @@ static double vr_get_audio_clock(VideoRenderer* vr) {
 
 double vr_get_master_time(VideoRenderer* vr) {
     if (!vr) return 0.0;
-    Uint32 now_ticks = vr->clock_paused ? vr->clock_pause_ticks : SDL_GetTicks();
-    Uint32 elapsed = now_ticks - vr->clock_start_ticks;
-    Uint32 active_ms = elapsed > vr->clock_pause_accum ? (elapsed - vr->clock_pause_accum) : 0;
-    double t = vr->clock_start_time + ((double)active_ms / 1000.0) * vr->playback_speed;
+    double t = amp_clock_get(&vr->clock);
     return t < 0.0 ? 0.0 : t;
 }
 
+static void vr_reset_av_sync(VideoRenderer* vr) {
+    vr->av_diff_cum = 0.0;
+    vr->av_diff_count = 0;
+    vr->av_error = 0.0;
+    vr->av_correction = 0;
+}
+
 static void vr_free_track_lists(VideoRenderer* vr) {
     if (!vr) return;
     for (int i = 0; i < vr->audio_count; i++) free(vr->audio_names[i]);
@@ -184,17 +404,51 @@ static void vr_free_track_lists(VideoRenderer* vr) {
     vr->audio_count = 0;
     vr->current_audio = -1;
 
-    for (int i = 0; i < vr->subtitle_count; i++) free(vr->subtitle_names[i]);
+    for (int i = 0; i < vr->subtitle_count; i++) {
+        free(vr->subtitle_names[i]);
+        subfile_free(vr->subtitle_files[i]);
+    }
     free(vr->subtitle_names);
     free(vr->subtitle_streams);
+    free(vr->subtitle_files);
     vr->subtitle_names = NULL;
     vr->subtitle_streams = NULL;
+    vr->subtitle_files = NULL;
     vr->subtitle_count = 0;
     vr->current_subtitle = -1;
+    vr->active_subfile = NULL;
+    vr->subfile_attached = 0;
+}
+
+/* Video texture and conversion buffer are YUV 4:2:0, the subtitle texture RGBA. */
+static void vr_account_video(VideoRenderer* vr) {
+    int64_t pixels = (int64_t)vr->width * vr->height;
+    int64_t bytes = 0;
+    if (vr->texture) bytes += pixels * 3 / 2;
+    if (vr->yuv_buffer) bytes += pixels * 3 / 2;
+    if (vr->subtitle_texture) bytes += pixels * 4;
+    budget_set(BUDGET_VIDEO, bytes);
 }
 
 static void vr_reset_stream(VideoRenderer* vr) {
     if (!vr) return;
+    vr_seek_wait(vr);
+    gop_cache_clear(&vr->gop);
+    gop_cache_clear(&vr->gop_next);
+    vr->gop_pos = -1;
+    vr->reversing = 0;
+    vr->gop_next_ready = 0;
+    vr->hidden = 0;
+    loop_cache_clear(&vr->loop);
+    vr->loop_video = LOOP_OFF;
+    vr->loop_audio = LOOP_OFF;
+    vr->loop_mark = -1.0;
+    key_index_builder_free(vr->key_builder);
+    vr->key_builder = NULL;
+    key_index_free(&vr->key_index);
+    thumb_worker_free(vr->thumbs);
+    vr->thumbs = NULL;
+
     if (vr->subtitle_texture) {
         SDL_DestroyTexture(vr->subtitle_texture);
         vr->subtitle_texture = NULL;
@@ -220,14 +474,11 @@ static void vr_reset_stream(VideoRenderer* vr) {
         vr->sws_ctx = NULL;
     }
     if (vr->video_ctx) {
-        avcodec_free_context(&vr->video_ctx);
+        frame_pool_free_context(&vr->video_ctx);
         vr->video_ctx = NULL;
     }
 
-    if (vr->audio_dev) {
-        SDL_CloseAudioDevice(vr->audio_dev);
-        vr->audio_dev = 0;
-    }
+    vr_close_audio_output(vr);
     if (vr->audio_frame) {
         av_frame_free(&vr->audio_frame);
         vr->audio_frame = NULL;
@@ -244,14 +495,17 @@ static void vr_reset_stream(VideoRenderer* vr) {
     vr->audio_base_samples = 0;
     vr->audio_samples_written = 0;
     vr->audio_clock_valid = 0;
+    vr_reset_av_sync(vr);
     if (vr->swr_ctx) {
         swr_free(&vr->swr_ctx);
         vr->swr_ctx = NULL;
     }
-    if (vr->audio_ctx) {
-        avcodec_free_context(&vr->audio_ctx);
-        vr->audio_ctx = NULL;
+    for (int i = 0; vr->audio_ctxs && i < vr->audio_count; i++) {
+        frame_pool_free_context(&vr->audio_ctxs[i]);
     }
+    free(vr->audio_ctxs);
+    vr->audio_ctxs = NULL;
+    vr->audio_ctx = NULL;
 
     if (vr->subtitle_ctx) {
         avcodec_free_context(&vr->subtitle_ctx);
@@ -264,18 +518,20 @@ static void vr_reset_stream(VideoRenderer* vr) {
     if (vr->ass_renderer) {
         ass_renderer_done(vr->ass_renderer);
         vr->ass_renderer = NULL;
+        budget_set(BUDGET_SUBTITLES, 0);
     }
     if (vr->ass_lib) {
         ass_library_done(vr->ass_lib);
         vr->ass_lib = NULL;
     }
 
-    if (vr->pending_valid) {
-        av_packet_unref(&vr->pending_pkt);
-        vr->pending_valid = 0;
-    }
     pkt_queue_clear(&vr->video_pktq);
-    pkt_queue_clear(&vr->audio_pktq);
+    for (int i = 0; vr->audio_pktqs && i < vr->audio_count; i++) {
+        pkt_queue_free(&vr->audio_pktqs[i]);
+    }
+    free(vr->audio_pktqs);
+    vr->audio_pktqs = NULL;
+    vr->audio_pktq = NULL;
 
     if (vr->fmt_ctx) {
         avformat_close_input(&vr->fmt_ctx);
@@ -291,13 +547,12 @@ static void vr_reset_stream(VideoRenderer* vr) {
     vr->width = 0;
     vr->height = 0;
     vr->video_ready = 0;
+    vr->frame_pending = 0;
+    vr->eof = 0;
     vr->current_time = 0.0;
     vr->last_time = 0.0;
-    vr->clock_start_ticks = SDL_GetTicks();
-    vr->clock_pause_ticks = 0;
-    vr->clock_pause_accum = 0;
-    vr->clock_paused = 0;
-    vr->clock_start_time = 0.0;
+    amp_clock_set(&vr->clock, 0.0);
+    vr_account_video(vr);
 }
 
 static char* vr_dup_stream_name(const AVStream* stream, const char* kind) {
@@ -325,47 +580,560 @@ static void vr_add_track(VideoRenderer* vr, int is_audio, int stream_index, cons
     } else {
         vr->subtitle_streams = (int*)realloc(vr->subtitle_streams, sizeof(int) * (vr->subtitle_count + 1));
         vr->subtitle_names = (char**)realloc(vr->subtitle_names, sizeof(char*) * (vr->subtitle_count + 1));
+        vr->subtitle_files = (SubFile**)realloc(vr->subtitle_files, sizeof(SubFile*) * (vr->subtitle_count + 1));
         vr->subtitle_streams[vr->subtitle_count] = stream_index;
         vr->subtitle_names[vr->subtitle_count] = strdup(name);
+        vr->subtitle_files[vr->subtitle_count] = NULL;
         vr->subtitle_count++;
     }
 }
 
+static void vr_add_sidecar_tracks(VideoRenderer* vr, const char* filename) {
+    static const struct { const char* ext; SubFileFormat format; } sidecars[] = {
+        { ".srt", SUBFILE_SRT },
+        { ".ass", SUBFILE_ASS },
+        { ".ssa", SUBFILE_ASS },
+        { ".vtt", SUBFILE_VTT },
+    };
+    const char* name = nob_path_name(filename);
+    const char* dot = strrchr(name, '.');
+    size_t base_len = dot ? (size_t)(dot - filename) : strlen(filename);
+
+    for (size_t i = 0; i < NOB_ARRAY_LEN(sidecars); i++) {
+        size_t ext_len = strlen(sidecars[i].ext);
+        char* path = (char*)malloc(base_len + ext_len + 1);
+        if (!path) continue;
+        memcpy(path, filename, base_len);
+        memcpy(path + base_len, sidecars[i].ext, ext_len + 1);
+        if (nob_file_exists(path) == 1) {
+            SubFile* sf = subfile_open_async(path, sidecars[i].format);
+            if (sf) {
+                char label[256];
+                snprintf(label, sizeof(label), "%s (external)", nob_path_name(path));
+                vr_add_track(vr, 0, -1, label);
+                vr->subtitle_files[vr->subtitle_count - 1] = sf;
+            }
+        }
+        free(path);
+    }
+}
+
+/* Number of input samples this frame should stretch or squeeze to, so that the
+ * audio output follows the master clock. Small drift is absorbed by
+ * resampling; a large jump (startup, seek) re-anchors the master clock. */
+static int vr_sync_audio(VideoRenderer* vr, int nb_samples) {
+    if (!vr->audio_clock_valid || vr->playback_speed != 1.0 || vr->clock.paused) return nb_samples;
+
+    double audio_time = vr_get_audio_clock(vr);
+    double diff = audio_time - vr_get_master_time(vr);
+    if (fabs(diff) >= AV_NOSYNC_THRESHOLD_SEC) {
+        amp_clock_set(&vr->clock, audio_time);
+        vr_reset_av_sync(vr);
+        return nb_samples;
+    }
+
+    double coef = exp(log(0.01) / AV_DIFF_AVG_NB);
+    vr->av_diff_cum = diff + coef * vr->av_diff_cum;
+    if (vr->av_diff_count < AV_DIFF_AVG_NB) {
+        vr->av_diff_count++;
+        vr->av_error = diff;
+        return nb_samples;
+    }
+    vr->av_error = vr->av_diff_cum * (1.0 - coef);
+    if (fabs(vr->av_error) < AV_SYNC_THRESHOLD_SEC) return nb_samples;
+
+    int wanted = nb_samples + (int)(diff * vr->audio_ctx->sample_rate);
+    int min_samples = (int)(nb_samples * (1.0 - AV_MAX_CORRECTION));
+    int max_samples = (int)(nb_samples * (1.0 + AV_MAX_CORRECTION));
+    if (wanted < min_samples) wanted = min_samples;
+    if (wanted > max_samples) wanted = max_samples;
+    return wanted;
+}
+
+static int vr_init_resampler(VideoRenderer* vr) {
+    AVChannelLayout out_layout;
+    av_channel_layout_default(&out_layout, vr->audio_spec.channels);
+    if (swr_alloc_set_opts2(&vr->swr_ctx,
+            &out_layout, AV_SAMPLE_FMT_FLT, vr->audio_spec.freq,
+            &vr->audio_ctx->ch_layout, vr->audio_ctx->sample_fmt, vr->audio_ctx->sample_rate,
+            0, NULL) < 0 || swr_init(vr->swr_ctx) < 0) {
+        nob_log(NOB_ERROR, "Failed to initialise audio resampler");
+        swr_free(&vr->swr_ctx);
+        return 0;
+    }
+    return 1;
+}
+
+/* Decoded audio goes straight to the device when only a sample format
+ * conversion is needed; that is folded into the gain pass below. */
+static int vr_audio_direct_ok(VideoRenderer* vr, int format, int sample_rate, int channels) {
+    if (vr->audio_spec.format != AUDIO_F32SYS || vr->audio_spec.channels != 2) return 0;
+    if (sample_rate != vr->audio_spec.freq) return 0;
+    if (channels != 1 && channels != 2) return 0;
+    switch (format) {
+        case AV_SAMPLE_FMT_FLT:
+        case AV_SAMPLE_FMT_FLTP:
+        case AV_SAMPLE_FMT_S16:
+        case AV_SAMPLE_FMT_S16P:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static inline float vr_clamp_sample(float v) {
+    v = v > 1.0f ? 1.0f : v;
+    return v < -1.0f ? -1.0f : v;
+}
+
+static void vr_apply_gain(float* restrict samples, int count, float gain) {
+    if (gain == 1.0f) return;
+    for (int i = 0; i < count; i++) samples[i] = vr_clamp_sample(samples[i] * gain);
+}
+
+/* Gain is applied here rather than at decode time so volume changes reach the
+ * output within one device buffer, ramped to avoid clicks. */
+static void SDLCALL vr_audio_callback(void* userdata, Uint8* stream, int len) {
+    VideoRenderer* vr = (VideoRenderer*)userdata;
+    float* out = (float*)stream;
+    int channels = vr->audio_spec.channels;
+    int frames = len / (int)(sizeof(float) * channels);
+
+    int n = frames < vr->audio_ring_size ? frames : vr->audio_ring_size;
+    int first = vr->audio_ring_cap - vr->audio_ring_read;
+    if (first > n) first = n;
+    if (n > 0) {
+        memcpy(out, vr->audio_ring + (size_t)vr->audio_ring_read * channels, (size_t)first * channels * sizeof(float));
+        memcpy(out + (size_t)first * channels, vr->audio_ring, (size_t)(n - first) * channels * sizeof(float));
+        vr->audio_ring_read = (vr->audio_ring_read + n) % vr->audio_ring_cap;
+        vr->audio_ring_size -= n;
+    }
+    if (n < frames && vr->audio_primed) {
+        vr->audio_starved++;
+        vr->audio_primed = 0;
+    }
+    if (n > 0 && vr->resume_audio_pending) {
+        vr->resume_audio_ms = (double)(amp_clock_now_ns() - vr->resume_ns) * 1e-6;
+        vr->resume_audio_pending = 0;
+    }
+    memset(out + (size_t)n * channels, 0, (size_t)(frames - n) * channels * sizeof(float));
+
+    float g = vr->audio_gain;
+    float target = vr->audio_volume;
+    int i = 0;
+    if (g != target) {
+        float step = 1.0f / ((float)vr->audio_spec.freq * (float)AUDIO_GAIN_RAMP_SEC);
+        for (; i < frames && g != target; i++) {
+            g = g < target ? fminf(g + step, target) : fmaxf(g - step, target);
+            for (int c = 0; c < channels; c++) out[i * channels + c] = vr_clamp_sample(out[i * channels + c] * g);
+        }
+        vr->audio_gain = g;
+    }
+    vr_apply_gain(out + (size_t)i * channels, (frames - i) * channels, g);
+}
+
+/* Only this thread writes to the ring, so its size can only shrink between
+ * the check here and taking the lock; a bigger ring is allocated unlocked
+ * and swapped in under the lock. A chunk that cannot fit is dropped. */
+static void vr_audio_write(VideoRenderer* vr, const float* samples, int frames) {
+    int channels = vr->audio_spec.channels;
+    float* ring = NULL;
+    int cap = vr->audio_ring_cap;
+    SDL_LockAudioDevice(vr->audio_dev);
+    int needed = vr->audio_ring_size + frames;
+    SDL_UnlockAudioDevice(vr->audio_dev);
+    if (needed > cap) {
+        cap = cap ? cap * 2 : vr->audio_spec.freq;
+        while (cap < needed) cap *= 2;
+        ring = (float*)malloc((size_t)cap * channels * sizeof(float));
+        if (!ring) {
+            nob_log(NOB_ERROR, "Failed to grow the audio ring to %d frames, dropping %d", cap, frames);
+            return;
+        }
+    }
+
+    SDL_LockAudioDevice(vr->audio_dev);
+    if (ring) {
+        if (vr->audio_ring_size > 0) {
+            int first = vr->audio_ring_cap - vr->audio_ring_read;
+            if (first > vr->audio_ring_size) first = vr->audio_ring_size;
+            memcpy(ring, vr->audio_ring + (size_t)vr->audio_ring_read * channels, (size_t)first * channels * sizeof(float));
+            memcpy(ring + (size_t)first * channels, vr->audio_ring, (size_t)(vr->audio_ring_size - first) * channels * sizeof(float));
+        }
+        free(vr->audio_ring);
+        budget_add(BUDGET_AUDIO, (int64_t)(cap - vr->audio_ring_cap) * channels * sizeof(float));
+        vr->audio_ring = ring;
+        vr->audio_ring_cap = cap;
+        vr->audio_ring_read = 0;
+    }
+    int w = (vr->audio_ring_read + vr->audio_ring_size) % vr->audio_ring_cap;
+    int first = vr->audio_ring_cap - w;
+    if (first > frames) first = frames;
+    memcpy(vr->audio_ring + (size_t)w * channels, samples, (size_t)first * channels * sizeof(float));
+    memcpy(vr->audio_ring, samples + (size_t)first * channels, (size_t)(frames - first) * channels * sizeof(float));
+    vr->audio_ring_size += frames;
+    vr->audio_primed = 1;
+    SDL_UnlockAudioDevice(vr->audio_dev);
+}
+
+static void vr_open_audio_output(VideoRenderer* vr) {
+    SDL_AudioSpec want;
+    SDL_zero(want);
+    want.freq = vr->audio_ctx->sample_rate;
+    want.format = AUDIO_F32SYS;
+    want.channels = 2;
+    want.samples = vr->low_latency ? AUDIO_LOW_LATENCY_SAMPLES : AUDIO_DEVICE_SAMPLES;
+    want.callback = vr_audio_callback;
+    want.userdata = vr;
+    vr->audio_gain = vr->audio_volume;
+    vr->audio_dev = SDL_OpenAudioDevice(NULL, 0, &want, &vr->audio_spec,
+                                         SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
+    if (!vr->audio_dev) {
+        nob_log(NOB_ERROR, "Failed to open audio device: %s", SDL_GetError());
+        return;
+    }
+    SDL_PauseAudioDevice(vr->audio_dev, 0);
+    vr->audio_stable_since = amp_clock_now_ns() * 1e-9;
+    nob_log(NOB_INFO, "Audio output: %d Hz, %d sample buffer, %.0f ms queue target",
+            vr->audio_spec.freq, vr->audio_spec.samples, vr->audio_target * 1000.0);
+
+    if (!vr_audio_direct_ok(vr, vr->audio_ctx->sample_fmt, vr->audio_ctx->sample_rate,
+                            vr->audio_ctx->ch_layout.nb_channels)) {
+        vr_init_resampler(vr);
+    }
+    vr->audio_frame = av_frame_alloc();
+}
+
+/* Interleaves a mono or stereo frame to stereo float with gain applied. */
+static void vr_convert_direct(const AVFrame* frame, float* restrict out, float gain) {
+    int n = frame->nb_samples;
+    int stereo = frame->ch_layout.nb_channels == 2;
+    if (!stereo) gain *= AUDIO_MONO_GAIN; /* level mono as swresample's upmix does */
+    switch (frame->format) {
+        case AV_SAMPLE_FMT_FLT: {
+            const float* in = (const float*)frame->data[0];
+            if (stereo) {
+                for (int i = 0; i < n * 2; i++) out[i] = vr_clamp_sample(in[i] * gain);
+            } else {
+                for (int i = 0; i < n; i++) out[2*i] = out[2*i + 1] = vr_clamp_sample(in[i] * gain);
+            }
+        } break;
+        case AV_SAMPLE_FMT_FLTP: {
+            const float* l = (const float*)frame->data[0];
+            const float* r = (const float*)frame->data[stereo ? 1 : 0];
+            for (int i = 0; i < n; i++) {
+                out[2*i] = vr_clamp_sample(l[i] * gain);
+                out[2*i + 1] = vr_clamp_sample(r[i] * gain);
+            }
+        } break;
+        case AV_SAMPLE_FMT_S16: {
+            const int16_t* in = (const int16_t*)frame->data[0];
+            float g = gain * (1.0f / 32768.0f);
+            if (stereo) {
+                for (int i = 0; i < n * 2; i++) out[i] = vr_clamp_sample(in[i] * g);
+            } else {
+                for (int i = 0; i < n; i++) out[2*i] = out[2*i + 1] = vr_clamp_sample(in[i] * g);
+            }
+        } break;
+        case AV_SAMPLE_FMT_S16P: {
+            const int16_t* l = (const int16_t*)frame->data[0];
+            const int16_t* r = (const int16_t*)frame->data[stereo ? 1 : 0];
+            float g = gain * (1.0f / 32768.0f);
+            for (int i = 0; i < n; i++) {
+                out[2*i] = vr_clamp_sample(l[i] * g);
+                out[2*i + 1] = vr_clamp_sample(r[i] * g);
+            }
+        } break;
+        default:
+            break;
+    }
+}
+
+/* Linear resampling of `n` interleaved frames to `wanted`, for the small
+ * sync corrections made without swresample. */
+static void vr_stretch_audio(const float* restrict src, int n, float* restrict dst, int wanted, int channels) {
+    for (int i = 0; i < wanted; i++) {
+        double x = (double)i * n / wanted;
+        int j = (int)x;
+        int k = j + 1 < n ? j + 1 : j;
+        float f = (float)(x - j);
+        for (int c = 0; c < channels; c++) {
+            float s0 = src[j * channels + c];
+            dst[i * channels + c] = s0 + (src[k * channels + c] - s0) * f;
+        }
+    }
+}
+
+static double vr_loop_length(VideoRenderer* vr) {
+    return vr->loop_b - vr->loop_a;
+}
+
+static int vr_loop_replaying(VideoRenderer* vr) {
+    return vr->loop_video == LOOP_FRAMES || vr->loop_video == LOOP_PACKETS || vr->loop_audio == LOOP_PCM;
+}
+
+static int vr_loop_over(VideoRenderer* vr) {
+    return loop_cache_bytes(&vr->loop) > budget_share(LOOP_CACHE_BUDGET_SHARE, LOOP_CACHE_MAX_BYTES);
+}
+
+/* Audio has reached B on the first pass: from here on it replays the PCM. */
+static void vr_loop_audio_wrap(VideoRenderer* vr) {
+    int freq = vr->audio_spec.freq;
+    vr->loop.channels = vr->audio_spec.channels;
+    if (!loop_cache_fit_pcm(&vr->loop, vr->loop_a, (int64_t)(vr_loop_length(vr) * freq + 0.5), freq)) {
+        nob_log(NOB_ERROR, "Failed to keep the loop's audio");
+        vr->loop_audio = LOOP_OFF;
+        return;
+    }
+    vr->loop_audio = LOOP_PCM;
+    vr->loop_audio_pos = 0;
+    vr->loop_audio_offset = vr_loop_length(vr);
+    pkt_queue_clear(vr->audio_pktq);
+}
+
+/* Over the cache limit. Decoded frames go first and video replays from its
+ * packets instead; past that the loop gives up on caching and seeks back to
+ * A on every pass. Once video replays from memory only audio can still
+ * grow, and it stops recording where it is. */
+static void vr_loop_shed(VideoRenderer* vr) {
+    if (vr->loop_video == LOOP_RECORD && vr->loop_frames_ok) {
+        nob_log(NOB_INFO, "Loop frames exceed the cache (%d frames, %.1f MB), keeping packets only",
+                vr->loop.frame_count, (double)vr->loop.frame_bytes / (1024.0 * 1024.0));
+        loop_cache_drop_frames(&vr->loop);
+        frame_pool_trim(vr->video_ctx);
+        vr->loop_frames_ok = 0;
+        if (!vr_loop_over(vr)) return;
+    }
+    if (vr->loop_video == LOOP_RECORD) {
+        nob_log(NOB_WARNING, "Loop %.3f-%.3fs does not fit in memory, seeking back on every pass",
+                vr->loop_a, vr->loop_b);
+        loop_cache_clear(&vr->loop);
+        vr->loop_video = LOOP_SEEK;
+        if (vr->loop_audio != LOOP_OFF) vr->loop_audio = LOOP_SEEK;
+        return;
+    }
+    if (vr->loop_audio == LOOP_RECORD) vr_loop_audio_wrap(vr);
+}
+
+static void vr_loop_record_frame(VideoRenderer* vr, double t) {
+    if (!vr->loop_frames_ok) return;
+    if (!loop_cache_push_frame(&vr->loop, vr->frame, t) || vr_loop_over(vr)) vr_loop_shed(vr);
+}
+
+static void vr_loop_record_packet(VideoRenderer* vr, const AVPacket* pkt) {
+    if (!loop_cache_push_packet(&vr->loop, pkt) || vr_loop_over(vr)) vr_loop_shed(vr);
+}
+
+/* Keeps the part of an output chunk ending at `end` that lies between A and
+ * B. Returns how many frames of it to play; the rest is past B. */
+static int vr_loop_record_audio(VideoRenderer* vr, const float* samples, int frames, double end) {
+    int freq = vr->audio_spec.freq;
+    int channels = vr->audio_spec.channels;
+    double start = end - (double)frames / freq;
+    int lead = start < vr->loop_a ? (int)((vr->loop_a - start) * freq + 0.5) : 0;
+    int keep = end > vr->loop_b ? frames - (int)((end - vr->loop_b) * freq + 0.5) : frames;
+    if (lead > frames) lead = frames;
+    if (keep < 0) keep = 0;
+    if (keep > lead) {
+        if (vr->loop.pcm_frames == 0) vr->loop.pcm_start = start + (double)lead / freq;
+        if (!loop_cache_push_pcm(&vr->loop, samples + (size_t)lead * channels, keep - lead, channels)
+                || vr_loop_over(vr)) {
+            vr_loop_shed(vr);
+        }
+    }
+    if (keep < frames && vr->loop_audio == LOOP_RECORD) vr_loop_audio_wrap(vr);
+    return keep;
+}
+
+/* Writes cached PCM up to the queue target. The usual sync correction is
+ * applied by stretching each chunk linearly, so hours of replay do not
+ * drift from the master clock. */
+static void vr_loop_write_audio(VideoRenderer* vr) {
+    LoopCache* lc = &vr->loop;
+    int channels = lc->channels;
+    if (lc->pcm_frames <= 0 || channels != vr->audio_spec.channels) return;
+
+    double queued = vr_get_audio_queue_seconds(vr);
+    while (queued < vr->audio_target) {
+        int64_t left = lc->pcm_frames - vr->loop_audio_pos;
+        int n = left < LOOP_PCM_CHUNK ? (int)left : LOOP_PCM_CHUNK;
+        const float* src = lc->pcm + vr->loop_audio_pos * channels;
+        int wanted = vr_sync_audio(vr, n);
+        vr->av_correction = wanted - n;
+        if (wanted != n) {
+            int size = wanted * channels * (int)sizeof(float);
+            if (size > vr->audio_buf_size) {
+                vr->audio_buf = (uint8_t*)realloc(vr->audio_buf, size);
+                vr->audio_buf_size = size;
+            }
+            float* out = (float*)vr->audio_buf;
+            vr_stretch_audio(src, n, out, wanted, channels);
+            src = out;
+        }
+        vr_audio_write(vr, src, wanted);
+        vr->audio_samples_written += wanted;
+        vr->loop_audio_pos += n;
+        vr->audio_clock_pts = lc->pcm_start + vr->loop_audio_offset + (double)vr->loop_audio_pos / vr->audio_spec.freq;
+        if (vr->loop_audio_pos >= lc->pcm_frames) {
+            vr->loop_audio_pos = 0;
+            vr->loop_audio_offset += vr_loop_length(vr);
+        }
+        queued = vr_get_audio_queue_seconds(vr);
+    }
+}
+
+static void vr_loop_inject_packets(VideoRenderer* vr) {
+    for (int i = 0; i < vr->loop.packet_count; i++) {
+        AVPacket pkt;
+        memset(&pkt, 0, sizeof(pkt));
+        if (av_packet_ref(&pkt, &vr->loop.packets[i]) == 0) pkt_queue_push(&vr->video_pktq, &pkt);
+    }
+}
+
+/* Video has reached B on the first pass: replay from the cached frames, or
+ * failing that from the packets through the decoder. */
+static void vr_loop_video_wrap(VideoRenderer* vr) {
+    vr->loop_video_pos = 0;
+    vr->loop_video_offset = vr_loop_length(vr);
+    vr->loop_passes++;
+    pkt_queue_clear(&vr->video_pktq);
+    if (vr->loop_frames_ok && vr->loop.frame_count > 0) {
+        vr->loop_video = LOOP_FRAMES;
+        loop_cache_drop_packets(&vr->loop);
+        nob_log(NOB_INFO, "Loop replaying %d cached frames (%.1f MB)",
+                vr->loop.frame_count, (double)vr->loop.frame_bytes / (1024.0 * 1024.0));
+    } else if (vr->loop.packet_count > 0) {
+        vr->loop_video = LOOP_PACKETS;
+        avcodec_flush_buffers(vr->video_ctx);
+        vr->loop_draining = 0;
+        vr_loop_inject_packets(vr);
+        nob_log(NOB_INFO, "Loop replaying %d cached packets (%.1f MB)",
+                vr->loop.packet_count, (double)vr->loop.packet_bytes / (1024.0 * 1024.0));
+    } else {
+        vr->loop_video = LOOP_SEEK;
+    }
+}
+
+static void vr_loop_seek_back(VideoRenderer* vr) {
+    vr->loop_passes++;
+    vr_seek_request(vr, vr->loop_a, VR_SEEK_EXACT);
+}
+
+/* Next cached frame into vr->frame, with its time on the replay timeline. */
+static int vr_loop_next_frame(VideoRenderer* vr) {
+    LoopCache* lc = &vr->loop;
+    if (lc->frame_count <= 0) return 0;
+    av_frame_unref(vr->frame);
+    if (av_frame_ref(vr->frame, lc->frames[vr->loop_video_pos]) < 0) return 0;
+    vr->frame_pending_time = lc->times[vr->loop_video_pos] + vr->loop_video_offset;
+    vr->frame_pending = 1;
+    if (++vr->loop_video_pos == lc->frame_count) {
+        vr->loop_video_pos = 0;
+        vr->loop_video_offset += vr_loop_length(vr);
+        vr->loop_passes++;
+    }
+    return 1;
+}
+
+/* End of a pass in packet replay: drains the frames the decoder still
+ * holds, then queues the packets again. Returns 1 while a drained frame is
+ * in vr->frame. */
+static int vr_loop_rewind(VideoRenderer* vr) {
+    if (!vr->loop_draining) {
+        avcodec_send_packet(vr->video_ctx, NULL);
+        vr->loop_draining = 1;
+    }
+    if (avcodec_receive_frame(vr->video_ctx, vr->frame) == 0) return 1;
+    avcodec_flush_buffers(vr->video_ctx);
+    vr->loop_draining = 0;
+    vr->loop_video_offset += vr_loop_length(vr);
+    vr->loop_passes++;
+    vr_loop_inject_packets(vr);
+    return 0;
+}
+
+/* Called with a freshly decoded frame at media time frame_pending_time.
+ * Returns 0 when the frame is not to be shown. */
+static int vr_loop_keep_frame(VideoRenderer* vr) {
+    double t = vr->frame_pending_time + vr->loop_half;
+    switch (vr->loop_video) {
+        case LOOP_RECORD:
+            if (t < vr->loop_a) return 1;
+            if (t < vr->loop_b) {
+                vr_loop_record_frame(vr, vr->frame_pending_time);
+                return 1;
+            }
+            vr_loop_video_wrap(vr);
+            return 0;
+        case LOOP_PACKETS:
+            if (t < vr->loop_a || t >= vr->loop_b) return 0;
+            vr->frame_pending_time += vr->loop_video_offset;
+            return 1;
+        case LOOP_SEEK:
+            if (t < vr->loop_b || vr->seeking) return 1; /* the worker never goes past B */
+            vr_loop_seek_back(vr);
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+/* Media time of a point on the replay timeline. */
+static double vr_loop_fold(VideoRenderer* vr, double t) {
+    if (!vr_loop_replaying(vr) || t < vr->loop_b) return t;
+    return vr->loop_a + fmod(t - vr->loop_a, vr_loop_length(vr));
+}
+
 static void vr_queue_audio(VideoRenderer* vr, AVFrame* frame) {
-    if (!vr || !vr->audio_dev || !vr->swr_ctx) return;
-    int out_samples = (int)av_rescale_rnd(
-        swr_get_delay(vr->swr_ctx, vr->audio_ctx->sample_rate) + frame->nb_samples,
-        vr->audio_spec.freq, vr->audio_ctx->sample_rate, AV_ROUND_UP);
-
-    int out_channels = 2;
-    int out_linesize = 0;
-    int out_buf_size = av_samples_get_buffer_size(&out_linesize, out_channels, out_samples, AV_SAMPLE_FMT_S16, 1);
-    if (out_buf_size <= 0) return;
+    if (!vr || !vr->audio_dev) return;
+    if (vr->loop_audio == LOOP_PCM) return; /* past B, the cache takes over */
+    int wanted = vr_sync_audio(vr, frame->nb_samples);
+    vr->av_correction = wanted - frame->nb_samples;
+    /* sync corrections alone do not need swresample; see the direct path */
+    if (!vr->swr_ctx && !vr_audio_direct_ok(vr, frame->format, frame->sample_rate, frame->ch_layout.nb_channels)) {
+        if (!vr_init_resampler(vr)) return;
+    }
 
+    int out_channels = vr->audio_spec.channels;
+    int out_samples = wanted;
+    if (vr->swr_ctx) {
+        if (wanted != frame->nb_samples) {
+            swr_set_compensation(vr->swr_ctx,
+                (int)((int64_t)(wanted - frame->nb_samples) * vr->audio_spec.freq / vr->audio_ctx->sample_rate),
+                (int)((int64_t)wanted * vr->audio_spec.freq / vr->audio_ctx->sample_rate));
+        }
+        out_samples = (int)av_rescale_rnd(
+            swr_get_delay(vr->swr_ctx, vr->audio_ctx->sample_rate) + wanted,
+            vr->audio_spec.freq, vr->audio_ctx->sample_rate, AV_ROUND_UP);
+    }
+
+    /* the direct path converts behind the output and stretches into place */
+    int buf_samples = vr->swr_ctx || wanted == frame->nb_samples ? out_samples : out_samples + frame->nb_samples;
+    int out_buf_size = buf_samples * out_channels * (int)sizeof(float);
+    if (out_buf_size <= 0) return;
     if (out_buf_size > vr->audio_buf_size) {
         vr->audio_buf = (uint8_t*)realloc(vr->audio_buf, out_buf_size);
         vr->audio_buf_size = out_buf_size;
     }
 
-    uint8_t* out_planes[2] = { vr->audio_buf, NULL };
-    int converted = swr_convert(vr->swr_ctx, out_planes, out_samples,
+    float* samples = (float*)vr->audio_buf;
+    int converted;
+    if (vr->swr_ctx) {
+        uint8_t* out_planes[1] = { vr->audio_buf };
+        converted = swr_convert(vr->swr_ctx, out_planes, out_samples,
                                 (const uint8_t**)frame->data, frame->nb_samples);
-    if (converted <= 0) return;
-
-    int bytes = av_samples_get_buffer_size(NULL, out_channels, converted, AV_SAMPLE_FMT_S16, 1);
-    if (bytes <= 0) return;
-
-    int16_t* samples = (int16_t*)vr->audio_buf;
-    int sample_count = bytes / sizeof(int16_t);
-    float gain = vr->audio_volume;
-    for (int i = 0; i < sample_count; i++) {
-        int v = (int)(samples[i] * gain);
-        if (v > 32767) v = 32767;
-        if (v < -32768) v = -32768;
-        samples[i] = (int16_t)v;
+        if (converted <= 0) return;
+    } else if (wanted == frame->nb_samples) {
+        converted = frame->nb_samples;
+        vr_convert_direct(frame, samples, 1.0f);
+    } else {
+        float* raw = samples + (size_t)wanted * out_channels;
+        vr_convert_direct(frame, raw, 1.0f);
+        vr_stretch_audio(raw, frame->nb_samples, samples, wanted, out_channels);
+        converted = wanted;
     }
-
-    SDL_QueueAudio(vr->audio_dev, vr->audio_buf, bytes);
+    int timed = 0;
+    double end = 0.0;
     if (vr->audio_time_base.num != 0 && vr->audio_time_base.den != 0) {
         int64_t pts = frame->best_effort_timestamp;
         if (pts != AV_NOPTS_VALUE) {
@@ -381,11 +1149,19 @@ static void vr_queue_audio(VideoRenderer* vr, AVFrame* frame) {
                 vr->audio_clock_valid = 1;
             }
             double delay_sec = 0.0;
-            int64_t delay = swr_get_delay(vr->swr_ctx, vr->audio_ctx->sample_rate);
+            int64_t delay = vr->swr_ctx ? swr_get_delay(vr->swr_ctx, vr->audio_ctx->sample_rate) : 0;
             if (delay > 0) delay_sec = (double)delay / (double)vr->audio_ctx->sample_rate;
-            vr->audio_clock_pts = pts_sec + (double)converted / (double)vr->audio_spec.freq - delay_sec;
+            end = pts_sec + (double)converted / (double)vr->audio_spec.freq - delay_sec;
+            timed = 1;
         }
     }
+    if (timed && vr->loop_audio == LOOP_RECORD) {
+        int keep = vr_loop_record_audio(vr, samples, converted, end);
+        end -= (double)(converted - keep) / (double)vr->audio_spec.freq;
+        converted = keep;
+    }
+    if (converted > 0) vr_audio_write(vr, samples, converted);
+    if (timed) vr->audio_clock_pts = end;
     vr->audio_samples_written += converted;
 }
 
@@ -420,29 +1196,75 @@ static void vr_process_subtitle(VideoRenderer* vr, const AVPacket* pkt) {
             ass_process_chunk(vr->ass_track, r->ass, (int)strlen(r->ass),
                               start_ms, duration_ms);
         } else if (r->text && r->text[0]) {
-            char utf8_buf[2048];
+            size_t utf8_size = strlen(r->text) * 2 + 4;
+            char* utf8_buf = (char*)malloc(utf8_size);
             const char* encoding = "unknown";
-            const char* text_utf8 = subtitle_normalize_to_utf8(r->text, utf8_buf, sizeof(utf8_buf), &encoding);
-            char escaped[4096];
-            const char* src = text_utf8;
-            char* dst = escaped;
-            while (*src && dst < escaped + sizeof(escaped) - 2) {
-                if (*src == '{') { *dst++ = '\\'; *dst++ = '{'; }
-                else *dst++ = *src;
-                src++;
-            }
-            *dst = '\0';
-            char buf[4500]; /* warning: '%s' directive output may be truncated writing up to 4095 bytes into a region of size 4046 */
-            snprintf(buf, sizeof(buf),
-                "Dialogue: 0,0:00:00.00,0:00:05.00,Default,,0,0,0,,%s", escaped);
-            ass_process_chunk(vr->ass_track, buf, (int)strlen(buf),
+            const char* text_utf8 = utf8_buf
+                ? subtitle_normalize_to_utf8(r->text, utf8_buf, utf8_size, &encoding)
+                : r->text;
+            Nob_String_Builder chunk = {0};
+            nob_sb_appendf(&chunk, "%d,0,Default,,0,0,0,,", vr->subtitle_read_order++);
+            subtitle_append_ass_text(&chunk, text_utf8, strlen(text_utf8), 0);
+            ass_process_chunk(vr->ass_track, chunk.items, (int)chunk.count,
                               start_ms, duration_ms);
+            nob_sb_free(chunk);
+            free(utf8_buf);
         }
     }
 
     avsubtitle_free(&sub);
 }
 
+static AVCodecContext* vr_open_audio_decoder(VideoRenderer* vr, int idx) {
+    if (vr->audio_ctxs[idx]) return vr->audio_ctxs[idx];
+    AVStream* stream = vr->fmt_ctx->streams[vr->audio_streams[idx]];
+    const AVCodec* codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    if (!codec) return NULL;
+    AVCodecContext* ctx = avcodec_alloc_context3(codec);
+    avcodec_parameters_to_context(ctx, stream->codecpar);
+    frame_pool_attach(ctx);
+    if (avcodec_open2(ctx, (AVCodec*)codec, NULL) < 0) {
+        nob_log(NOB_ERROR, "Failed to open audio decoder for track %d", idx);
+        frame_pool_free_context(&ctx);
+        return NULL;
+    }
+    vr->audio_ctxs[idx] = ctx;
+    return ctx;
+}
+
+/* Switches the decoded audio track. The output device and whatever audio is
+ * already queued for it stay as they are; the new track picks up from the end
+ * of that queue using the packets kept for it by the demuxer. */
+void vr_select_audio_track(VideoRenderer* vr, int idx) {
+    if (!vr || idx < 0 || idx >= vr->audio_count || idx == vr->current_audio) return;
+    vr_clear_loop(vr); /* its PCM is the old track's */
+    vr_seek_wait(vr);
+    AVCodecContext* ctx = vr_open_audio_decoder(vr, idx);
+    if (!ctx) return;
+
+    AVStream* stream = vr->fmt_ctx->streams[vr->audio_streams[idx]];
+    double resume = vr->audio_clock_valid ? vr->audio_clock_pts : vr->current_time;
+    PacketQueue* q = &vr->audio_pktqs[idx];
+    pkt_queue_drop_before(q, vr->start_time, resume);
+    avcodec_flush_buffers(ctx);
+
+    vr->current_audio = idx;
+    vr->audio_stream_index = vr->audio_streams[idx];
+    vr->audio_ctx = ctx;
+    vr->audio_pktq = q;
+    vr->audio_time_base = stream->time_base;
+    vr_reset_av_sync(vr);
+
+    if (!vr->audio_dev) {
+        vr_open_audio_output(vr);
+        return;
+    }
+    if (vr->swr_ctx) swr_free(&vr->swr_ctx);
+    if (!vr_audio_direct_ok(vr, ctx->sample_fmt, ctx->sample_rate, ctx->ch_layout.nb_channels)) {
+        vr_init_resampler(vr);
+    }
+}
+
 VideoRenderer* vr_create(SDL_Window* window, SDL_Renderer* renderer) {
     avformat_network_init();
 
@@ -453,22 +1275,25 @@ VideoRenderer* vr_create(SDL_Window* window, SDL_Renderer* renderer) {
     vr->playback_speed = 1.0;
     vr->current_time = 0.0;
     vr->audio_volume = 1.0f;
+    vr->audio_target = AUDIO_QUEUE_TARGET_SEC;
+    vr->seek_mode = VR_SEEK_EXACT;
     vr->current_audio = -1;
     vr->current_subtitle = -1;
     vr->audio_clock_pts = 0.0;
     vr->start_time = 0.0;
     vr->start_time_set = 0;
-    vr->clock_start_ticks = SDL_GetTicks();
-    vr->clock_pause_ticks = 0;
-    vr->clock_pause_accum = 0;
-    vr->clock_paused = 0;
-    vr->clock_start_time = 0.0;
-    pkt_queue_init(&vr->video_pktq, VIDEO_PKT_QUEUE_CAP);
-    pkt_queue_init(&vr->audio_pktq, AUDIO_PKT_QUEUE_CAP);
-    vr->pending_valid = 0;
-    vr->frame_history_size = 0;
-    vr->frame_history_pos = 0;
-    memset(vr->frame_history, 0, sizeof(vr->frame_history));
+    amp_clock_init(&vr->clock, 0.0);
+    pkt_queue_init(&vr->video_pktq, VIDEO_PKT_QUEUE_MAX_BYTES, VIDEO_PKT_QUEUE_MAX_SEC, VIDEO_PKT_QUEUE_MIN_SEC);
+    pkt_queue_init(&vr->subtitle_pktq, 0, 0.0, 0.0);
+    vr->gop_pos = -1;
+    vr->loop_mark = -1.0;
+
+    vr->seek_lock = SDL_CreateMutex();
+    vr->seek_cond = SDL_CreateCond();
+    if (vr->seek_lock && vr->seek_cond) {
+        vr->seek_thread = SDL_CreateThread(vr_seek_worker, "amp-seek", vr);
+    }
+    if (!vr->seek_thread) nob_log(NOB_WARNING, "Seeking synchronously: %s", SDL_GetError());
     return vr;
 }
 
@@ -503,13 +1328,15 @@ int vr_load(VideoRenderer* vr, const char* filename) {
             if (!codec) { nob_log(NOB_ERROR, "Failed to find video decoder"); continue; }
             vr->video_ctx = avcodec_alloc_context3(codec);
             avcodec_parameters_to_context(vr->video_ctx, stream->codecpar);
+            frame_pool_attach(vr->video_ctx);
             if (avcodec_open2(vr->video_ctx, (AVCodec*)codec, NULL) < 0) {
                 nob_log(NOB_ERROR, "Failed to open video decoder");
-                avcodec_free_context(&vr->video_ctx);
+                frame_pool_free_context(&vr->video_ctx);
                 vr->video_ctx = NULL;
                 continue;
             }
             vr->video_time_base = stream->time_base;
+            pkt_queue_set_stream(&vr->video_pktq, stream);
             vr->width = vr->video_ctx->width;
             vr->height = vr->video_ctx->height;
 
@@ -528,6 +1355,7 @@ int vr_load(VideoRenderer* vr, const char* filename) {
                 av_image_get_buffer_size(AV_PIX_FMT_YUV420P, vr->width, vr->height, 1));
             av_image_fill_arrays(vr->yuv_frame->data, vr->yuv_frame->linesize,
                 vr->yuv_buffer, AV_PIX_FMT_YUV420P, vr->width, vr->height, 1);
+            vr_account_video(vr);
 
         } else if (stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
             char* name = vr_dup_stream_name(stream, "Audio");
@@ -539,55 +1367,25 @@ int vr_load(VideoRenderer* vr, const char* filename) {
             free(name);
         }
     }
+    vr_add_sidecar_tracks(vr, filename);
 
     if (vr->video_stream_index < 0 || !vr->video_ctx || !vr->fmt_ctx) {
         vr_reset_stream(vr);
         return 0;
     }
 
-    if (vr->audio_count > 0) {
-        vr->current_audio = 0;
-        vr->audio_stream_index = vr->audio_streams[0];
-    }
-
     vr->current_subtitle = -1;
     vr->subtitle_stream_index = -1;
 
-    if (vr->audio_stream_index >= 0) {
-        AVStream* stream = vr->fmt_ctx->streams[vr->audio_stream_index];
-        const AVCodec* codec = avcodec_find_decoder(stream->codecpar->codec_id);
-        if (codec) {
-            vr->audio_ctx = avcodec_alloc_context3(codec);
-            avcodec_parameters_to_context(vr->audio_ctx, stream->codecpar);
-            if (avcodec_open2(vr->audio_ctx, (AVCodec*)codec, NULL) < 0) {
-                avcodec_free_context(&vr->audio_ctx);
-                vr->audio_ctx = NULL;
-            }
-        }
-
-        if (vr->audio_ctx) {
-            vr->audio_time_base = stream->time_base;
-            SDL_AudioSpec want;
-            SDL_zero(want);
-            want.freq = vr->audio_ctx->sample_rate;
-            want.format = AUDIO_S16SYS;
-            want.channels = 2;
-            want.samples = 1024;
-            want.callback = NULL;
-            vr->audio_dev = SDL_OpenAudioDevice(NULL, 0, &want, &vr->audio_spec,
-                                                 SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
-            if (vr->audio_dev) SDL_PauseAudioDevice(vr->audio_dev, 0);
-
-            AVChannelLayout in_layout = vr->audio_ctx->ch_layout;
-            AVChannelLayout out_layout;
-            av_channel_layout_default(&out_layout, 2);
-            swr_alloc_set_opts2(&vr->swr_ctx,
-                &out_layout, AV_SAMPLE_FMT_S16, vr->audio_spec.freq,
-                &in_layout, vr->audio_ctx->sample_fmt, vr->audio_ctx->sample_rate,
-                0, NULL);
-            swr_init(vr->swr_ctx);
-            vr->audio_frame = av_frame_alloc();
+    if (vr->audio_count > 0) {
+        vr->audio_ctxs = (AVCodecContext**)calloc((size_t)vr->audio_count, sizeof(AVCodecContext*));
+        vr->audio_pktqs = (PacketQueue*)calloc((size_t)vr->audio_count, sizeof(PacketQueue));
+        for (int i = 0; i < vr->audio_count; i++) {
+            PacketQueue* q = &vr->audio_pktqs[i];
+            pkt_queue_init(q, AUDIO_PKT_QUEUE_MAX_BYTES, AUDIO_PKT_QUEUE_MAX_SEC, AUDIO_PKT_QUEUE_MIN_SEC);
+            pkt_queue_set_stream(q, vr->fmt_ctx->streams[vr->audio_streams[i]]);
         }
+        vr_select_audio_track(vr, 0);
     }
 
     if (!vr->ass_lib) {
@@ -596,6 +1394,9 @@ int vr_load(VideoRenderer* vr, const char* filename) {
     if (!vr->ass_renderer && vr->ass_lib) {
         vr->ass_renderer = ass_renderer_init(vr->ass_lib);
         ass_set_frame_size(vr->ass_renderer, vr->width, vr->height);
+        int64_t ass_cache = budget_share(ASS_CACHE_BUDGET_SHARE, ASS_CACHE_MAX_BYTES);
+        ass_set_cache_limits(vr->ass_renderer, 0, (int)(ass_cache / (1024 * 1024)));
+        budget_set(BUDGET_SUBTITLES, ass_cache);
         ass_set_fonts(vr->ass_renderer, NULL, "Arial", 1, NULL, 1);
     }
 
@@ -611,68 +1412,161 @@ int vr_load(VideoRenderer* vr, const char* filename) {
             i, vr->subtitle_names[i], vr->subtitle_streams[i]);
     }
 
+    vr->key_builder = key_index_builder_start(filename, vr->video_stream_index);
+    if (vr->video_ctx) vr->thumbs = thumb_worker_start(filename, vr->video_stream_index);
     return 1;
 }
 
-static void vr_demux_packets(VideoRenderer* vr) {
-    if (!vr || !vr->fmt_ctx) return;
-    int reads = 0;
-    const int max_reads = 32;
+/* Feeds the keyframe index into the demuxer so its own seek code can jump
+ * straight to the right byte offset. Streams whose index is already at
+ * least as complete (MP4 sample tables) are left alone. */
+static void vr_inject_key_index(VideoRenderer* vr) {
+    AVStream* st = vr->fmt_ctx->streams[vr->video_stream_index];
+    if (avformat_index_get_entries_count(st) >= vr->key_index.count) return;
+    for (int64_t i = 0; i < vr->key_index.count; i++) {
+        const KeyframeEntry* e = &vr->key_index.entries[i];
+        av_add_index_entry(st, e->pos, e->ts, 0, 0, AVINDEX_KEYFRAME);
+    }
+}
 
-    while (reads < max_reads) {
-        if (vr->pending_valid) {
-            int stream_index = vr->pending_pkt.stream_index;
-            if (stream_index == vr->video_stream_index) {
-                if (pkt_queue_is_full(&vr->video_pktq)) return;
-                pkt_queue_push(&vr->video_pktq, &vr->pending_pkt);
-            } else if (vr->audio_ctx && stream_index == vr->audio_stream_index) {
-                if (pkt_queue_is_full(&vr->audio_pktq)) return;
-                pkt_queue_push(&vr->audio_pktq, &vr->pending_pkt);
-            } else if (vr->subtitle_ctx
-                       && vr->subtitle_stream_index >= 0
-                       && stream_index == vr->subtitle_stream_index) {
-                vr_process_subtitle(vr, &vr->pending_pkt);
-            }
-            av_packet_unref(&vr->pending_pkt);
-            vr->pending_valid = 0;
-            continue;
+/* Uses an index remembered from an earlier session instead of building one. */
+void vr_adopt_key_index(VideoRenderer* vr, const KeyframeIndex* ki) {
+    if (!vr || !vr->fmt_ctx || !ki || ki->count <= 0 || ki->stream_index != vr->video_stream_index) return;
+    vr_seek_wait(vr);
+    AVStream* st = vr->fmt_ctx->streams[vr->video_stream_index];
+    if (av_cmp_q(ki->time_base, st->time_base) != 0) return;
+    key_index_builder_free(vr->key_builder);
+    vr->key_builder = NULL;
+    if (!key_index_copy(&vr->key_index, ki)) return;
+    vr_inject_key_index(vr);
+}
+
+/* Picks up the background builder's result once it has finished. */
+void vr_poll_key_index(VideoRenderer* vr) {
+    if (!vr || !vr->key_builder || vr->seeking) return;
+    int state = SDL_AtomicGet(&vr->key_builder->state);
+    if (state == 0) return;
+    if (state > 0) {
+        key_index_free(&vr->key_index);
+        vr->key_index = vr->key_builder->result;
+        memset(&vr->key_builder->result, 0, sizeof(vr->key_builder->result));
+        vr_inject_key_index(vr);
+        nob_log(NOB_INFO, "Keyframe index ready: %lld keyframes", (long long)vr->key_index.count);
+    }
+    key_index_builder_free(vr->key_builder);
+    vr->key_builder = NULL;
+}
+
+/* Index build progress in [0, 1], or 1 when no build is running. */
+double vr_key_index_progress(VideoRenderer* vr) {
+    if (!vr || !vr->key_builder) return 1.0;
+    return SDL_AtomicGet(&vr->key_builder->progress) / 1000.0;
+}
+
+/* Packets of audio tracks that are not playing go to their own queue, oldest
+ * dropped first, so a track switch can start at the current position. */
+static int vr_keep_side_audio(VideoRenderer* vr, AVPacket* pkt) {
+    for (int i = 0; vr->audio_pktqs && i < vr->audio_count; i++) {
+        if (vr->audio_streams[i] != pkt->stream_index) continue;
+        PacketQueue* q = &vr->audio_pktqs[i];
+        pkt_queue_push(q, pkt);
+        while ((pkt_queue_is_full(q) || (budget_over() && !pkt_queue_is_hungry(q))) && q->size > 1) {
+            AVPacket old;
+            pkt_queue_pop(q, &old);
+            av_packet_unref(&old);
         }
+        return 1;
+    }
+    return 0;
+}
+
+/* Reading stops once a queue is full, unless another one is below its
+ * low-water mark; audio is checked first since an audio gap is heard. Over
+ * the memory budget only a starving queue keeps the demuxer going. */
+static int vr_demux_wants_more(VideoRenderer* vr) {
+    PacketQueue* v = vr->video_ctx && !vr->hidden ? &vr->video_pktq : NULL;
+    PacketQueue* a = vr->audio_ctx ? vr->audio_pktq : NULL;
+    if (!budget_over() && !pkt_queue_is_full(v) && !pkt_queue_is_full(a)) return 1;
+    if (pkt_queue_is_hungry(a) && pkt_queue_fill(v) < 2.0) return 1;
+    if (pkt_queue_is_hungry(v) && pkt_queue_fill(a) < 2.0) return 1;
+    return 0;
+}
+
+/* Returns the number of packets read. */
+static int vr_demux_packets(VideoRenderer* vr) {
+    if (!vr || !vr->fmt_ctx) return 0;
+    int video_cached = vr->loop_video == LOOP_FRAMES || vr->loop_video == LOOP_PACKETS;
+    if (video_cached && vr->loop_audio != LOOP_RECORD) return 0; /* looping from memory */
+    int reads = 0;
+    const int max_reads = 32;
 
+    while (reads < max_reads && vr_demux_wants_more(vr)) {
         AVPacket pkt;
-        if (av_read_frame(vr->fmt_ctx, &pkt) < 0) return;
+        if (av_read_frame(vr->fmt_ctx, &pkt) < 0) {
+            vr->eof = 1;
+            return reads;
+        }
 
         if (pkt.stream_index == vr->video_stream_index) {
-            if (pkt_queue_is_full(&vr->video_pktq)) {
-                av_packet_move_ref(&vr->pending_pkt, &pkt);
-                vr->pending_valid = 1;
-                return;
-            }
-            pkt_queue_push(&vr->video_pktq, &pkt);
+            if (vr->loop_video == LOOP_RECORD) vr_loop_record_packet(vr, &pkt);
+            if (!video_cached && !vr->hidden) pkt_queue_push(&vr->video_pktq, &pkt);
         } else if (vr->audio_ctx && pkt.stream_index == vr->audio_stream_index) {
-            if (pkt_queue_is_full(&vr->audio_pktq)) {
-                av_packet_move_ref(&vr->pending_pkt, &pkt);
-                vr->pending_valid = 1;
-                return;
-            }
-            pkt_queue_push(&vr->audio_pktq, &pkt);
+            if (vr->loop_audio != LOOP_PCM) pkt_queue_push(vr->audio_pktq, &pkt);
+        } else if (vr_keep_side_audio(vr, &pkt)) {
+            /* kept for a later track switch */
         } else if (vr->subtitle_ctx
                    && vr->subtitle_stream_index >= 0
                    && pkt.stream_index == vr->subtitle_stream_index) {
-            vr_process_subtitle(vr, &pkt);
+            if (vr->demux_defer_subs) pkt_queue_push(&vr->subtitle_pktq, &pkt);
+            else vr_process_subtitle(vr, &pkt);
         }
         av_packet_unref(&pkt);
         reads++;
     }
+    return reads;
+}
+
+static double vr_base_audio_target(VideoRenderer* vr) {
+    return vr->low_latency ? AUDIO_LOW_LATENCY_TARGET_SEC : AUDIO_QUEUE_TARGET_SEC;
+}
+
+/* Raises the queue target by half after the device ran dry, and eases it back
+ * toward the base once playback has been clean for a while. Draining at the
+ * end of the file is not an underrun. */
+static void vr_adapt_audio_target(VideoRenderer* vr) {
+    SDL_LockAudioDevice(vr->audio_dev);
+    int starved = vr->audio_starved;
+    vr->audio_starved = 0;
+    SDL_UnlockAudioDevice(vr->audio_dev);
+
+    double now = amp_clock_now_ns() * 1e-9;
+    double base = vr_base_audio_target(vr);
+    if (starved > 0 && !(vr->eof && pkt_queue_is_empty(vr->audio_pktq))) {
+        vr->audio_underruns += starved;
+        vr->audio_target = fmin(vr->audio_target * 1.5, AUDIO_QUEUE_MAX_SEC);
+        vr->audio_stable_since = now;
+        nob_log(NOB_WARNING, "Audio underrun, queue target raised to %.0f ms", vr->audio_target * 1000.0);
+    } else if (vr->audio_target > base && now - vr->audio_stable_since > AUDIO_TARGET_DECAY_SEC) {
+        vr->audio_target = fmax(vr->audio_target * 0.8, base);
+        vr->audio_stable_since = now;
+    }
+}
+
+void vr_set_low_latency(VideoRenderer* vr, int enabled) {
+    if (!vr) return;
+    vr->low_latency = enabled ? 1 : 0;
+    vr->audio_target = vr_base_audio_target(vr);
 }
 
 static void vr_decode_audio(VideoRenderer* vr) {
     if (!vr || !vr->audio_ctx || !vr->audio_dev) return;
+    vr_adapt_audio_target(vr);
     double queued = vr_get_audio_queue_seconds(vr);
-    if (queued >= AUDIO_QUEUE_TARGET_SEC) return;
+    if (queued >= vr->audio_target) return;
 
-    while (queued < AUDIO_QUEUE_TARGET_SEC && !pkt_queue_is_empty(&vr->audio_pktq)) {
+    while (queued < vr->audio_target && vr->loop_audio != LOOP_PCM && !pkt_queue_is_empty(vr->audio_pktq)) {
         AVPacket pkt;
-        if (!pkt_queue_pop(&vr->audio_pktq, &pkt)) break;
+        if (!pkt_queue_pop(vr->audio_pktq, &pkt)) break;
         if (avcodec_send_packet(vr->audio_ctx, &pkt) == 0) {
             while (avcodec_receive_frame(vr->audio_ctx, vr->audio_frame) == 0) {
                 vr_queue_audio(vr, vr->audio_frame);
@@ -681,57 +1575,102 @@ static void vr_decode_audio(VideoRenderer* vr) {
         av_packet_unref(&pkt);
         queued = vr_get_audio_queue_seconds(vr);
     }
+    if (vr->loop_audio == LOOP_RECORD && vr->eof && pkt_queue_is_empty(vr->audio_pktq)) vr_loop_audio_wrap(vr);
+    if (vr->loop_audio == LOOP_PCM) vr_loop_write_audio(vr);
 }
 
-int vr_render_frame(VideoRenderer* vr) {
-    if (!vr || !vr->video_ctx) return 0;
-
-    while (!pkt_queue_is_empty(&vr->video_pktq)) {
-        AVPacket pkt;
-        if (!pkt_queue_pop(&vr->video_pktq, &pkt)) break;
-        if (avcodec_send_packet(vr->video_ctx, &pkt) < 0) {
+static int vr_decode_video(VideoRenderer* vr) {
+    if (!vr || !vr->video_ctx || vr->hidden) return 0;
+    if (vr->frame_pending) return 1;
+
+    int rewinds = 0;
+    for (;;) {
+        if (vr->loop_video == LOOP_FRAMES) return vr_loop_next_frame(vr);
+        if (!pkt_queue_is_empty(&vr->video_pktq)) {
+            AVPacket pkt;
+            if (!pkt_queue_pop(&vr->video_pktq, &pkt)) break;
+            if (avcodec_send_packet(vr->video_ctx, &pkt) < 0) {
+                av_packet_unref(&pkt);
+                continue;
+            }
             av_packet_unref(&pkt);
+            if (avcodec_receive_frame(vr->video_ctx, vr->frame) != 0) continue;
+        } else if (vr->loop_video == LOOP_PACKETS) {
+            if (!vr_loop_rewind(vr)) {
+                if (++rewinds > 1) break; /* a whole pass without a frame */
+                continue;
+            }
+        } else if (vr->eof && !vr->seeking && vr->loop_video == LOOP_RECORD) {
+            vr_loop_video_wrap(vr); /* B is past the last frame */
             continue;
+        } else if (vr->eof && !vr->seeking && vr->loop_video == LOOP_SEEK) {
+            vr_loop_seek_back(vr);
+            if (vr->seeking) return 0;
+            continue;
+        } else {
+            break;
         }
-        av_packet_unref(&pkt);
-
-        if (avcodec_receive_frame(vr->video_ctx, vr->frame) == 0) {
-            sws_scale(vr->sws_ctx,
-                (const uint8_t* const*)vr->frame->data,
-                vr->frame->linesize, 0, vr->height,
-                vr->yuv_frame->data, vr->yuv_frame->linesize);
-
-            SDL_UpdateYUVTexture(vr->texture, NULL,
-                vr->yuv_frame->data[0], vr->yuv_frame->linesize[0],
-                vr->yuv_frame->data[1], vr->yuv_frame->linesize[1],
-                vr->yuv_frame->data[2], vr->yuv_frame->linesize[2]);
-
-            vr->video_ready = 1;
-
-            int64_t vts = vr->frame->best_effort_timestamp;
-            if (vts != AV_NOPTS_VALUE) {
-                double vts_sec = vts * av_q2d(vr->video_time_base);
-                if (!vr->start_time_set) {
-                    vr->start_time = vts_sec;
-                    vr->start_time_set = 1;
-                }
-                vr->current_time = vts_sec - vr->start_time;
 
-                if (vr->frame_history_size < 32) {
-                    vr->frame_history[vr->frame_history_size++] = vr->current_time;
-                } else {
-                    for (int i = 1; i < 32; i++) vr->frame_history[i-1] = vr->frame_history[i];
-                    vr->frame_history[31] = vr->current_time;
-                }
-                vr->frame_history_pos = vr->frame_history_size - 1;
+        vr->frame_pending_time = vr->current_time;
+        int64_t vts = vr->frame->best_effort_timestamp;
+        if (vts != AV_NOPTS_VALUE) {
+            double vts_sec = vts * av_q2d(vr->video_time_base);
+            if (!vr->start_time_set) {
+                vr->start_time = vts_sec;
+                vr->start_time_set = 1;
             }
-            vr->playback_speed = vr->playback_speed > 0 ? vr->playback_speed : 1.0f;
-            return 1;
+            vr->frame_pending_time = vts_sec - vr->start_time;
+        }
+        if (vr->loop_video != LOOP_OFF && !vr_loop_keep_frame(vr)) {
+            if (vr->seeking) return 0; /* seeking back to A */
+            continue;
         }
+        vr->frame_pending = 1;
+        return 1;
     }
     return 0;
 }
 
+static void vr_upload_picture(VideoRenderer* vr, const AVFrame* frame) {
+    sws_scale(vr->sws_ctx,
+        (const uint8_t* const*)frame->data,
+        frame->linesize, 0, vr->height,
+        vr->yuv_frame->data, vr->yuv_frame->linesize);
+
+    SDL_UpdateYUVTexture(vr->texture, NULL,
+        vr->yuv_frame->data[0], vr->yuv_frame->linesize[0],
+        vr->yuv_frame->data[1], vr->yuv_frame->linesize[1],
+        vr->yuv_frame->data[2], vr->yuv_frame->linesize[2]);
+
+    vr->video_ready = 1;
+}
+
+static void vr_upload_frame(VideoRenderer* vr) {
+    vr_upload_picture(vr, vr->frame);
+    vr->frame_pending = 0;
+    if (vr->frame->best_effort_timestamp != AV_NOPTS_VALUE) vr->current_time = vr->frame_pending_time;
+    vr->playback_speed = vr->playback_speed > 0 ? vr->playback_speed : 1.0f;
+}
+
+static void vr_drop_frame(VideoRenderer* vr) {
+    if (vr->frame->best_effort_timestamp != AV_NOPTS_VALUE) vr->current_time = vr->frame_pending_time;
+    vr->frame_pending = 0;
+}
+
+int vr_render_frame(VideoRenderer* vr) {
+    if (!vr_decode_video(vr)) return 0;
+    vr_upload_frame(vr);
+    return 1;
+}
+
+/* Seconds until the audio queue drops to half its target, or -1 when there is nothing to refill it with. */
+static double vr_audio_refill_delay(VideoRenderer* vr) {
+    if (!vr || !vr->audio_ctx || !vr->audio_dev) return -1.0;
+    if (vr->eof && pkt_queue_is_empty(vr->audio_pktq) && vr->loop_audio != LOOP_PCM) return -1.0;
+    double delay = vr_get_audio_queue_seconds(vr) - vr->audio_target * 0.5;
+    return delay < 0.0 ? 0.0 : delay;
+}
+
 SDL_Texture* vr_get_texture(VideoRenderer* vr) {
     return (vr && vr->video_ready) ? vr->texture : NULL;
 }
@@ -740,6 +1679,10 @@ SDL_Texture* vr_get_subtitle_texture(VideoRenderer* vr) {
     return vr ? vr->subtitle_texture : NULL;
 }
 
+double vr_get_av_error(VideoRenderer* vr) {
+    return vr ? vr->av_error : 0.0;
+}
+
 double vr_get_video_time(VideoRenderer* vr) {
     return vr ? vr->current_time : 0.0;
 }
@@ -751,12 +1694,13 @@ double vr_get_audio_time(VideoRenderer* vr) {
 
 void vr_resync_audio(VideoRenderer* vr, double target_time) {
     if (!vr || !vr->audio_dev) return;
-    SDL_ClearQueuedAudio(vr->audio_dev);
+    vr_clear_audio(vr);
     if (vr->audio_ctx) avcodec_flush_buffers(vr->audio_ctx);
     vr->audio_clock_base = target_time;
     vr->audio_base_samples = 0;
     vr->audio_samples_written = 0;
     vr->audio_clock_valid = 1;
+    vr_reset_av_sync(vr);
 }
 
 int vr_render_subtitles(VideoRenderer* vr, double seconds) {
@@ -764,9 +1708,19 @@ int vr_render_subtitles(VideoRenderer* vr, double seconds) {
     if (vr->current_subtitle < 0) return 0;
     if (!vr->ass_track) return 0;
 
+    long long now_ms = (long long)(seconds * 1000.0);
+    if (vr->active_subfile) {
+        if (!vr->subfile_attached) {
+            if (!subfile_ready(vr->active_subfile)) return 0;
+            subfile_attach(vr->active_subfile, vr->ass_track);
+            subfile_seek(vr->active_subfile, vr->ass_track, now_ms);
+            vr->subfile_attached = 1;
+        }
+        subfile_feed(vr->active_subfile, vr->ass_track, now_ms);
+    }
+
     int changed = 0;
-    ASS_Image* img = ass_render_frame(vr->ass_renderer, vr->ass_track,
-                                      (long long)(seconds * 1000.0), &changed);
+    ASS_Image* img = ass_render_frame(vr->ass_renderer, vr->ass_track, now_ms, &changed);
     if (!img) return 0;
 
     if (!vr->subtitle_texture) {
@@ -774,6 +1728,7 @@ int vr_render_subtitles(VideoRenderer* vr, double seconds) {
             SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING,
             vr->width, vr->height);
         SDL_SetTextureBlendMode(vr->subtitle_texture, SDL_BLENDMODE_BLEND);
+        vr_account_video(vr);
     }
 
     void* pixels = NULL;
@@ -831,16 +1786,128 @@ int vr_render_subtitles(VideoRenderer* vr, double seconds) {
     return 1;
 }
 
-void vr_seek(VideoRenderer* vr, double seconds) {
-    if (!vr) return;
-    int64_t ts = (int64_t)(seconds / av_q2d(vr->fmt_ctx->streams[vr->video_stream_index]->time_base));
+static double vr_frame_duration(VideoRenderer* vr) {
+    if (!vr->video_ctx || vr->video_time_base.num <= 0 || vr->video_time_base.den <= 0) return 0.04;
+    if (vr->fmt_ctx && vr->video_stream_index >= 0) {
+        AVStream* stream = vr->fmt_ctx->streams[vr->video_stream_index];
+        if (stream->avg_frame_rate.num > 0 && stream->avg_frame_rate.den > 0) {
+            return 1.0 / av_q2d(stream->avg_frame_rate);
+        }
+    }
+    return av_q2d(vr->video_time_base);
+}
+
+/* Moves every clock to media time `t`. */
+static void vr_set_position(VideoRenderer* vr, double t) {
+    vr->audio_clock_base = t;
+    vr->audio_clock_pts = t;
+    vr->audio_base_samples = 0;
+    vr->audio_samples_written = 0;
+    vr->audio_clock_valid = 1;
+    vr_reset_av_sync(vr);
+    vr->current_time = t;
+    vr->last_time = t;
+    amp_clock_set(&vr->clock, t);
+}
+
+static void vr_drop_audio_before(VideoRenderer* vr, double t) {
+    for (int i = 0; vr->audio_pktqs && i < vr->audio_count; i++) {
+        pkt_queue_drop_before(&vr->audio_pktqs[i], vr->start_time, t);
+    }
+}
+
+/* Repositions the demuxer on the keyframe at or before `seconds` and drops
+ * everything queued or buffered in the decoders. Safe on the seek worker. */
+static void vr_seek_demuxer(VideoRenderer* vr, double seconds) {
+    int64_t ts = (int64_t)((seconds + vr->start_time) / av_q2d(vr->fmt_ctx->streams[vr->video_stream_index]->time_base));
+    int64_t kf = key_index_find(&vr->key_index, ts);
+    if (kf >= 0) ts = vr->key_index.entries[kf].ts; /* land exactly on the GOP start */
     av_seek_frame(vr->fmt_ctx, vr->video_stream_index, ts, AVSEEK_FLAG_BACKWARD);
     avcodec_flush_buffers(vr->video_ctx);
-    if (vr->audio_ctx) avcodec_flush_buffers(vr->audio_ctx);
+    for (int i = 0; vr->audio_ctxs && i < vr->audio_count; i++) {
+        if (vr->audio_ctxs[i]) avcodec_flush_buffers(vr->audio_ctxs[i]);
+    }
     if (vr->subtitle_ctx) avcodec_flush_buffers(vr->subtitle_ctx);
-    if (vr->audio_dev) SDL_ClearQueuedAudio(vr->audio_dev);
+    vr->frame_pending = 0;
+    vr->eof = 0;
+    pkt_queue_clear(&vr->video_pktq);
+    for (int i = 0; vr->audio_pktqs && i < vr->audio_count; i++) pkt_queue_clear(&vr->audio_pktqs[i]);
+    pkt_queue_clear(&vr->subtitle_pktq);
+}
+
+/* Decodes forward from the keyframe the demuxer landed on. Fast mode stops at
+ * the first frame; exact mode discards frames, without converting or
+ * uploading them, until the one covering `target`. Audio before the target
+ * is dropped as it arrives so its queue cannot stall the demuxer. Gives up
+ * early, returning 0, once request `serial` has been superseded. */
+static int vr_seek_decode(VideoRenderer* vr, double target, VrSeekMode mode, int serial) {
+    double half = vr_frame_duration(vr) * 0.5;
+    int skipped = 0;
+    for (;;) {
+        if (serial >= 0 && SDL_AtomicGet(&vr->seek_serial) != serial) return 0;
+        if (!vr_decode_video(vr)) {
+            if (vr->eof) break;
+            vr_demux_packets(vr);
+            if (mode == VR_SEEK_EXACT) vr_drop_audio_before(vr, target);
+            if (pkt_queue_is_empty(&vr->video_pktq) && !vr->eof) break; /* demuxer held back */
+            continue;
+        }
+        if (mode == VR_SEEK_FAST || vr->frame_pending_time + half >= target) break;
+        vr->frame_pending = 0;
+        skipped++;
+    }
+    SDL_AtomicSet(&vr->seek_skipped, skipped);
+    return 1;
+}
+
+/* Decodes, from the keyframe before it, every frame presented before `end`
+ * into `gc`. An empty cache means there is nothing before `end`. Audio read
+ * on the way is dropped. Returns 0 once request `serial` is superseded. */
+static int vr_gop_fill(VideoRenderer* vr, GopCache* gc, double end, int serial) {
+    double dur = vr_frame_duration(vr);
+    double half = dur * 0.5;
+    int64_t max_bytes = budget_share(GOP_CACHE_BUDGET_SHARE, GOP_CACHE_MAX_BYTES);
+    gop_cache_clear(gc);
+    if (end - half <= 0.0) return 1;
+    vr_seek_demuxer(vr, end - dur);
+    for (;;) {
+        if (serial >= 0 && SDL_AtomicGet(&vr->seek_serial) != serial) return 0;
+        if (!vr_decode_video(vr)) {
+            if (vr->eof) break;
+            vr_demux_packets(vr);
+            vr_drop_audio_before(vr, end);
+            if (pkt_queue_is_empty(&vr->video_pktq) && !vr->eof) break;
+            continue;
+        }
+        vr->frame_pending = 0;
+        if (vr->frame_pending_time + half >= end) break;
+        gop_cache_push(gc, vr->frame, vr->frame_pending_time, max_bytes);
+    }
+    return 1;
+}
+
+/* Drops the cached GOPs and ends reverse playback. The caller repositions
+ * the decoder. */
+static void vr_gop_reset(VideoRenderer* vr) {
+    if (vr->gop.count > 0) {
+        gop_cache_clear(&vr->gop);
+        frame_pool_trim(vr->video_ctx);
+    }
+    vr->gop_pos = -1;
+    if (vr->reversing) {
+        vr->reversing = 0;
+        if (vr->audio_dev && !vr->clock.paused) SDL_PauseAudioDevice(vr->audio_dev, 0);
+    }
+}
 
-    if (vr->ass_track && vr->ass_lib) {
+/* Main-thread half of a seek: subtitles, audio output and the clocks, and the
+ * single upload of the frame the decode stopped on. */
+static void vr_seek_finish(VideoRenderer* vr, double seconds, VrSeekMode mode) {
+    vr_clear_audio(vr);
+
+    if (vr->active_subfile) {
+        if (vr->subfile_attached) subfile_seek(vr->active_subfile, vr->ass_track, (int64_t)(seconds * 1000.0));
+    } else if (vr->ass_track && vr->ass_lib) {
         ass_free_track(vr->ass_track);
         vr->ass_track = ass_new_track(vr->ass_lib);
         if (vr->ass_track) {
@@ -856,109 +1923,422 @@ void vr_seek(VideoRenderer* vr, double seconds) {
             }
         }
     }
-
-    vr->audio_clock_base = seconds;
-    vr->audio_clock_pts = seconds;
-    vr->audio_base_samples = 0;
-    vr->audio_samples_written = 0;
-    vr->audio_clock_valid = 1;
-    vr->current_time = seconds;
-    vr->last_time = seconds;
-    vr->clock_start_ticks = SDL_GetTicks();
-    vr->clock_pause_ticks = 0;
-    vr->clock_pause_accum = 0;
-    vr->clock_paused = 0;
-    vr->clock_start_time = seconds;
-
-    if (vr->pending_valid) {
-        av_packet_unref(&vr->pending_pkt);
-        vr->pending_valid = 0;
+    AVPacket pkt;
+    while (pkt_queue_pop(&vr->subtitle_pktq, &pkt)) {
+        vr_process_subtitle(vr, &pkt);
+        av_packet_unref(&pkt);
     }
-    pkt_queue_clear(&vr->video_pktq);
-    pkt_queue_clear(&vr->audio_pktq);
-}
-
-double vr_get_time(VideoRenderer* vr) {
-    if (!vr) return 0.0;
 
-    if (vr->audio_dev && vr->audio_clock_valid) {
-        double audio_time = vr_get_audio_clock(vr);
-        if (audio_time < vr->last_time) return vr->last_time;
-        vr->last_time = audio_time;
-        return audio_time;
+    double t = seconds;
+    if (vr->frame_pending) {
+        if (mode == VR_SEEK_FAST) t = vr->frame_pending_time;
+        vr_upload_frame(vr);
     }
+    vr_set_position(vr, t);
+    vr_drop_audio_before(vr, t);
+}
 
-    if (vr->current_time < vr->last_time) return vr->last_time;
-    vr->last_time = vr->current_time;
-    return vr->current_time;
+static void vr_seek_with_mode(VideoRenderer* vr, double seconds, VrSeekMode mode) {
+    if (!vr || !vr->fmt_ctx) return;
+    vr_seek_wait(vr);
+    vr_gop_reset(vr);
+    vr_seek_demuxer(vr, seconds);
+    vr_seek_decode(vr, seconds, mode, -1);
+    vr_seek_finish(vr, seconds, mode);
 }
 
-void vr_next_frame(VideoRenderer* vr, int count) {
-    if (!vr || count == 0) return;
-    int step = (count > 0) ? 1 : -1;
-    int n = abs(count);
-    double frame_duration = 0.04;
-
-    if (vr && vr->video_ctx && vr->video_time_base.num > 0 && vr->video_time_base.den > 0) {
-        AVRational tb = vr->video_time_base;
-        double fps = 0.0;
-        if (vr->fmt_ctx && vr->video_stream_index >= 0) {
-            AVStream* stream = vr->fmt_ctx->streams[vr->video_stream_index];
-            if (stream->avg_frame_rate.num > 0 && stream->avg_frame_rate.den > 0) {
-                fps = av_q2d(stream->avg_frame_rate);
-            }
+/* Seek worker. Requests carry a serial; a request that is superseded while
+ * it decodes is abandoned and the worker moves straight on to the newest
+ * target, so a burst of seeks costs one seek. While a request is in flight
+ * the worker owns the demuxer and decoders; subtitle packets it reads are
+ * parked for the main thread, which owns the ASS track. */
+static int SDLCALL vr_seek_worker(void* userdata) {
+    VideoRenderer* vr = (VideoRenderer*)userdata;
+    SDL_LockMutex(vr->seek_lock);
+    for (;;) {
+        while (!vr->seek_quit && SDL_AtomicGet(&vr->seek_serial) == vr->seek_done_serial) {
+            SDL_CondWait(vr->seek_cond, vr->seek_lock);
         }
-        if (fps > 0.0) {
-            frame_duration = 1.0 / fps;
+        if (vr->seek_quit) break;
+        int serial = SDL_AtomicGet(&vr->seek_serial);
+        double target = vr->seek_target;
+        VrSeekMode mode = vr->seek_target_mode;
+        int gop = vr->seek_target_gop;
+        SDL_UnlockMutex(vr->seek_lock);
+
+        vr->demux_defer_subs = 1;
+        int finished;
+        if (gop) {
+            finished = vr_gop_fill(vr, &vr->gop_next, target, serial);
         } else {
-            frame_duration = av_q2d(tb);
+            vr_seek_demuxer(vr, target);
+            finished = vr_seek_decode(vr, target, mode, serial);
+        }
+        vr->demux_defer_subs = 0;
+
+        SDL_LockMutex(vr->seek_lock);
+        if (finished && SDL_AtomicGet(&vr->seek_serial) == serial) {
+            vr->seek_done_serial = serial;
+            SDL_CondBroadcast(vr->seek_cond);
         }
     }
+    SDL_UnlockMutex(vr->seek_lock);
+    return 0;
+}
 
-    for (int i = 0; i < n; i++) {
-        if (step > 0) {
-            vr_demux_packets(vr);
-            vr_decode_audio(vr);
-            vr_render_frame(vr);
-        } else {
-            int prev_pos = vr->frame_history_pos - 1;
-            if (prev_pos < 0) prev_pos = 0;
-            double t = vr->frame_history_size > 0 ? vr->frame_history[prev_pos] : (vr_get_time(vr) - frame_duration);
-            if (t < 0.0) t = 0.0;
-            vr_seek(vr, t);
-
-            int rendered = 0;
-            int tries = 0;
-            while (!rendered && tries < 32) {
-                vr_demux_packets(vr);
-                vr_decode_audio(vr);
-                rendered = vr_render_frame(vr);
-                tries++;
+/* Applies a finished background seek. Returns 1 when one was applied. */
+int vr_seek_poll(VideoRenderer* vr) {
+    if (!vr || !vr->seeking) return 0;
+    SDL_LockMutex(vr->seek_lock);
+    int done = vr->seek_done_serial == SDL_AtomicGet(&vr->seek_serial);
+    double target = vr->seek_target;
+    VrSeekMode mode = vr->seek_target_mode;
+    int gop = vr->seek_target_gop;
+    SDL_UnlockMutex(vr->seek_lock);
+    if (!done) return 0;
+    vr->seeking = 0;
+    if (gop) {
+        vr->gop_next_ready = 1;
+        pkt_queue_clear(&vr->subtitle_pktq); /* subtitles are not shown in reverse */
+        return 1;
+    }
+    if (vr->gop_next.count > 0) {
+        gop_cache_clear(&vr->gop_next);
+        frame_pool_trim(vr->video_ctx);
+    }
+    vr->gop_next_ready = 0;
+    vr->seeks_done++;
+    if (mode == VR_SEEK_FAST) {
+        double cost = amp_clock_now_ns() * 1e-9 - vr->seek_started;
+        vr->scrub_cost = vr->scrub_cost > 0.0 ? vr->scrub_cost * 0.75 + cost * 0.25 : cost;
+    }
+    vr_seek_finish(vr, target, mode);
+    return 1;
+}
+
+/* Blocks until the worker is idle and applies its last result. Anything that
+ * touches the demuxer or decoders from the main thread calls this first. */
+static void vr_seek_wait(VideoRenderer* vr) {
+    if (!vr->seeking) return;
+    SDL_LockMutex(vr->seek_lock);
+    while (vr->seek_done_serial != SDL_AtomicGet(&vr->seek_serial)) SDL_CondWait(vr->seek_cond, vr->seek_lock);
+    SDL_UnlockMutex(vr->seek_lock);
+    vr_seek_poll(vr);
+}
+
+int vr_seeking(VideoRenderer* vr) {
+    return vr && vr->seeking;
+}
+
+/* Queues a seek for the worker, replacing any that has not finished. The
+ * clocks move to the target right away so repeated relative seeks build on
+ * it and the timeline follows. */
+static void vr_seek_request(VideoRenderer* vr, double seconds, VrSeekMode mode) {
+    if (!vr || !vr->fmt_ctx) return;
+    vr->seek_requests++;
+    if (!vr->seek_thread) {
+        vr_seek_with_mode(vr, seconds, mode);
+        vr->seeks_done++;
+        return;
+    }
+    vr_gop_reset(vr);
+    vr_clear_audio(vr);
+    vr_set_position(vr, seconds);
+    vr->seek_started = amp_clock_now_ns() * 1e-9;
+    SDL_LockMutex(vr->seek_lock);
+    vr->seek_target = seconds;
+    vr->seek_target_mode = mode;
+    vr->seek_target_gop = 0;
+    SDL_AtomicAdd(&vr->seek_serial, 1);
+    vr->seeking = 1;
+    SDL_CondBroadcast(vr->seek_cond);
+    SDL_UnlockMutex(vr->seek_lock);
+}
+
+/* Ends an A-B loop where it stands; for callers that seek right after. */
+static void vr_loop_cancel(VideoRenderer* vr) {
+    if (vr->loop_video == LOOP_OFF && vr->loop_audio == LOOP_OFF) return;
+    vr_seek_wait(vr); /* the worker may be recording packets */
+    int had_frames = vr->loop.frame_count > 0;
+    loop_cache_clear(&vr->loop);
+    if (had_frames) frame_pool_trim(vr->video_ctx);
+    vr->loop_video = LOOP_OFF;
+    vr->loop_audio = LOOP_OFF;
+    vr->loop_draining = 0;
+}
+
+void vr_seek(VideoRenderer* vr, double seconds) {
+    if (!vr) return;
+    vr_loop_cancel(vr);
+    vr_seek_request(vr, seconds, vr->seek_mode);
+}
+
+/* Timeline scrubbing: shows the keyframe at or before `seconds`. Drop the
+ * drag with vr_seek_exact so playback resumes on the frame asked for. */
+void vr_scrub(VideoRenderer* vr, double seconds) {
+    if (!vr) return;
+    vr_loop_cancel(vr);
+    vr_seek_request(vr, seconds, VR_SEEK_FAST);
+}
+
+void vr_seek_exact(VideoRenderer* vr, double seconds) {
+    if (!vr) return;
+    vr_loop_cancel(vr);
+    vr_seek_request(vr, seconds, VR_SEEK_EXACT);
+}
+
+/* Minimum spacing between scrub seeks. It follows the measured cost of a
+ * fast seek, so cheap all-intra files scrub at display rate and long-GOP
+ * files back off instead of piling up latency. */
+double vr_scrub_interval(VideoRenderer* vr) {
+    double cost = vr ? vr->scrub_cost : 0.0;
+    if (cost < SCRUB_MIN_INTERVAL_SEC) return SCRUB_MIN_INTERVAL_SEC;
+    if (cost > SCRUB_MAX_INTERVAL_SEC) return SCRUB_MAX_INTERVAL_SEC;
+    return cost;
+}
+
+/* A-B loop. The first pass plays from an exact seek to A and keeps the
+ * decoded frames (or, past the cache limit, the packets from the keyframe
+ * before A) and the output PCM. Later passes replay those with no seek, so
+ * the loop point is seamless. Loops that do not fit at all seek back to A
+ * at B instead. Seeking, stepping and reverse end the loop. */
+void vr_set_loop(VideoRenderer* vr, double a, double b) {
+    if (!vr || !vr->fmt_ctx || !vr->video_ctx) return;
+    if (a > b) {
+        double t = a;
+        a = b;
+        b = t;
+    }
+    if (a < 0.0) a = 0.0;
+    if (b - a < LOOP_MIN_SEC) return;
+    vr_loop_cancel(vr);
+    vr_seek_wait(vr); /* nothing else may be demuxing once recording starts */
+    vr->loop_a = a;
+    vr->loop_b = b;
+    vr->loop_half = vr_frame_duration(vr) * 0.5;
+    vr->loop_frames_ok = 1;
+    vr->loop_passes = 0;
+    vr->loop_video = LOOP_RECORD;
+    vr->loop_audio = vr->audio_ctx && vr->audio_dev ? LOOP_RECORD : LOOP_OFF;
+    nob_log(NOB_INFO, "Loop %.3f-%.3fs", a, b);
+    vr_seek_request(vr, a, VR_SEEK_EXACT);
+}
+
+/* Ends the loop and carries on from the current position. */
+void vr_clear_loop(VideoRenderer* vr) {
+    if (!vr || (vr->loop_video == LOOP_OFF && vr->loop_audio == LOOP_OFF)) return;
+    int replaying = vr_loop_replaying(vr);
+    double t = vr_loop_fold(vr, vr_get_audio_time(vr));
+    vr_loop_cancel(vr);
+    if (replaying) vr_seek_request(vr, t, VR_SEEK_EXACT); /* back onto media time */
+}
+
+int vr_get_loop(VideoRenderer* vr, double* a, double* b) {
+    if (!vr || (vr->loop_video == LOOP_OFF && vr->loop_audio == LOOP_OFF)) return 0;
+    if (a) *a = vr->loop_a;
+    if (b) *b = vr->loop_b;
+    return 1;
+}
+
+void vr_set_seek_mode(VideoRenderer* vr, VrSeekMode mode) {
+    if (vr) vr->seek_mode = mode;
+}
+
+/* Shows cached frame `idx` without touching the decoder. */
+static void vr_gop_show(VideoRenderer* vr, int idx) {
+    vr->gop_pos = idx;
+    vr_upload_picture(vr, vr->gop.frames[idx]);
+    vr_set_position(vr, vr->gop.times[idx]);
+}
+
+/* Caches the GOP up to and including the frame on screen. */
+static int vr_gop_enter(VideoRenderer* vr) {
+    vr_seek_wait(vr);
+    double cur = vr->current_time;
+    double dur = vr_frame_duration(vr);
+    vr_clear_audio(vr);
+    vr_gop_fill(vr, &vr->gop, cur + dur, -1);
+    int idx = gop_cache_find(&vr->gop, cur + dur * 0.5);
+    if (idx < 0) {
+        gop_cache_clear(&vr->gop);
+        return 0;
+    }
+    vr->gop_pos = idx;
+    return 1;
+}
+
+/* Leaves the cached GOP: the decoder is sent back to the frame on screen so
+ * forward playback continues from it. */
+static void vr_gop_leave(VideoRenderer* vr) {
+    if (vr->gop_pos < 0) return;
+    vr_seek_exact(vr, vr->current_time);
+}
+
+/* Asks the seek worker for the stretch before the cached one. */
+static void vr_gop_request(VideoRenderer* vr, double end) {
+    vr->gop_next_end = end;
+    vr->gop_next_ready = 0;
+    if (!vr->seek_thread) {
+        vr_gop_fill(vr, &vr->gop_next, end, -1);
+        vr->gop_next_ready = 1;
+        return;
+    }
+    SDL_LockMutex(vr->seek_lock);
+    vr->seek_target = end;
+    vr->seek_target_mode = VR_SEEK_EXACT;
+    vr->seek_target_gop = 1;
+    SDL_AtomicAdd(&vr->seek_serial, 1);
+    vr->seeking = 1;
+    SDL_CondBroadcast(vr->seek_cond);
+    SDL_UnlockMutex(vr->seek_lock);
+}
+
+/* Prefetches the previous GOP once the picture is in the older half of the
+ * cached one, so stepping and reverse playback cross GOP boundaries without
+ * waiting on a decode. */
+static void vr_gop_prefetch(VideoRenderer* vr) {
+    if (vr->gop_pos < 0 || vr->gop_pos > vr->gop.count / 2 || vr->seeking) return;
+    double end = vr->gop.times[0];
+    if (vr->gop_next_end == end && vr->gop_next_ready) return;
+    vr_gop_request(vr, end);
+}
+
+/* Moves to the GOP before the cached one, blocking for it when `wait` is
+ * set. Returns 1 when it is now cached, 0 when it is not ready yet or the
+ * cached GOP is the first. */
+static int vr_gop_previous(VideoRenderer* vr, int wait) {
+    double end = vr->gop.times[0];
+    if (wait) vr_seek_wait(vr);
+    if (!(vr->gop_next_ready && vr->gop_next_end == end)) {
+        if (vr->seeking && !wait) return 0;
+        vr_gop_request(vr, end);
+        if (!wait) return 0;
+        vr_seek_wait(vr);
+    }
+    if (!vr->gop_next_ready || vr->gop_next.count == 0) return 0;
+    GopCache tmp = vr->gop;
+    vr->gop = vr->gop_next;
+    vr->gop_next = tmp;
+    gop_cache_clear(&vr->gop_next);
+    vr->gop_next_ready = 0;
+    vr->gop_next_end = -1.0;
+    vr->gop_pos = vr->gop.count - 1;
+    return 1;
+}
+
+static void vr_step_back(VideoRenderer* vr) {
+    if (vr->gop_pos < 0 && !vr_gop_enter(vr)) return;
+    if (vr->gop_pos > 0) vr_gop_show(vr, vr->gop_pos - 1);
+    else if (vr_gop_previous(vr, 1)) vr_gop_show(vr, vr->gop_pos);
+    vr_gop_prefetch(vr);
+}
+
+static void vr_step_forward(VideoRenderer* vr) {
+    if (vr->gop_pos >= 0 && vr->gop_pos + 1 < vr->gop.count) {
+        vr_gop_show(vr, vr->gop_pos + 1);
+        return;
+    }
+    if (vr->gop_pos >= 0) {
+        /* past the cache: the decoder stopped one frame further on */
+        vr_seek_with_mode(vr, vr->current_time + vr_frame_duration(vr), VR_SEEK_EXACT);
+        return;
+    }
+    vr_seek_wait(vr);
+    vr_demux_packets(vr);
+    vr_decode_audio(vr);
+    vr_render_frame(vr);
+}
+
+/* Plays backwards at the playback speed, from the cached GOPs. Audio is
+ * muted. Ends by itself at the start of the file. */
+void vr_set_reverse(VideoRenderer* vr, int on) {
+    if (!vr || !vr->video_ctx || !on == !vr->reversing) return;
+    vr_clear_loop(vr);
+    if (!on) {
+        vr->reversing = 0;
+        if (vr->audio_dev && !vr->clock.paused) SDL_PauseAudioDevice(vr->audio_dev, 0);
+        vr_gop_leave(vr);
+        return;
+    }
+    if (vr->gop_pos < 0 && !vr_gop_enter(vr)) return;
+    if (vr->audio_dev) SDL_PauseAudioDevice(vr->audio_dev, 1);
+    vr->reversing = 1;
+    vr->reverse_wall = amp_clock_now_ns() * 1e-9;
+    vr->reverse_media = vr->gop.times[vr->gop_pos];
+}
+
+int vr_reversing(VideoRenderer* vr) {
+    return vr && vr->reversing;
+}
+
+/* Shows the frame due now in reverse playback. Returns the seconds until
+ * the next one is due and sets *shown when the picture changed. */
+double vr_reverse_tick(VideoRenderer* vr, int* shown) {
+    *shown = 0;
+    if (!vr || !vr->reversing || vr->gop_pos < 0) return 0.1;
+    double now = amp_clock_now_ns() * 1e-9;
+    double speed = vr->playback_speed > 0.0 ? vr->playback_speed : 1.0;
+    double media = vr->reverse_media - (now - vr->reverse_wall) * speed;
+    if (media < vr->gop.times[0]) {
+        if (!vr_gop_previous(vr, 0)) {
+            if (vr->gop_next_ready && vr->gop_next_end == vr->gop.times[0] && vr->gop_next.count == 0) {
+                vr_set_reverse(vr, 0); /* reached the first frame */
+                return 0.1;
             }
-            vr->frame_history_pos = prev_pos;
+            /* hold the boundary frame until the previous GOP is decoded */
+            vr->reverse_media = vr->gop.times[0];
+            vr->reverse_wall = now;
+            return 0.004;
         }
     }
+    int idx = gop_cache_find(&vr->gop, media);
+    if (idx < 0) idx = 0;
+    if (idx != vr->gop_pos) {
+        vr_gop_show(vr, idx);
+        *shown = 1;
+    }
+    vr_gop_prefetch(vr);
+    double until = (media - vr->gop.times[idx]) / speed;
+    return until > 0.0 ? until : 0.001;
+}
+
+double vr_get_time(VideoRenderer* vr) {
+    if (!vr) return 0.0;
+
+    double t = vr->current_time;
+    if (vr->audio_dev && vr->audio_clock_valid) t = vr_get_audio_clock(vr);
+    if (t < vr->last_time) t = vr->last_time;
+    vr->last_time = t;
+    return vr_loop_fold(vr, t);
+}
+
+void vr_next_frame(VideoRenderer* vr, int count) {
+    if (!vr || count == 0 || !vr->video_ctx) return;
+    if (vr->reversing) vr_set_reverse(vr, 0);
+    vr_clear_loop(vr);
+    vr_seek_wait(vr);
+    for (int i = 0; i < abs(count); i++) {
+        if (count > 0) vr_step_forward(vr);
+        else vr_step_back(vr);
+    }
 }
 
 void vr_set_speed(VideoRenderer* vr, double speed) {
     if (!vr) return;
     if (speed <= 0.0) speed = 1.0;
-    double now_time = vr_get_master_time(vr);
     vr->playback_speed = speed;
-    vr->clock_start_time = now_time;
-    vr->clock_start_ticks = SDL_GetTicks();
-    vr->clock_pause_accum = 0;
-    if (vr->clock_paused) {
-        vr->clock_pause_ticks = vr->clock_start_ticks;
-    }
+    amp_clock_set_speed(&vr->clock, speed);
+    vr->reverse_wall = amp_clock_now_ns() * 1e-9;
+    vr->reverse_media = vr->current_time;
 }
 
 void vr_set_volume(VideoRenderer* vr, float volume) {
     if (!vr) return;
     if (volume < 0.0f) volume = 0.0f;
     if (volume > 2.0f) volume = 2.0f;
+    if (vr->audio_dev) SDL_LockAudioDevice(vr->audio_dev);
     vr->audio_volume = volume;
-    if (vr->audio_dev) SDL_ClearQueuedAudio(vr->audio_dev);
+    if (vr->audio_dev) SDL_UnlockAudioDevice(vr->audio_dev);
 }
 
 float vr_get_volume(VideoRenderer* vr) {
@@ -988,63 +2368,9 @@ const char* vr_get_subtitle_track_name(VideoRenderer* vr, int idx) {
     return vr->subtitle_names[idx];
 }
 
-void vr_select_audio_track(VideoRenderer* vr, int idx) {
-    if (!vr || idx < 0 || idx >= vr->audio_count) return;
-    vr->audio_stream_index = vr->audio_streams[idx];
-    vr->current_audio = idx;
-
-    vr->audio_clock_base = 0.0;
-    vr->audio_base_samples = 0;
-    vr->audio_samples_written = 0;
-    vr->audio_clock_valid = 0;
-
-    if (vr->pending_valid) {
-        av_packet_unref(&vr->pending_pkt);
-        vr->pending_valid = 0;
-    }
-    pkt_queue_clear(&vr->audio_pktq);
-
-    if (vr->audio_dev) { SDL_CloseAudioDevice(vr->audio_dev); vr->audio_dev = 0; }
-    if (vr->audio_ctx) { avcodec_free_context(&vr->audio_ctx); vr->audio_ctx = NULL; }
-    if (vr->swr_ctx)   { swr_free(&vr->swr_ctx); vr->swr_ctx = NULL; }
-    if (vr->audio_frame) { av_frame_free(&vr->audio_frame); vr->audio_frame = NULL; }
-
-    AVStream* stream = vr->fmt_ctx->streams[vr->audio_stream_index];
-    const AVCodec* codec = avcodec_find_decoder(stream->codecpar->codec_id);
-    if (!codec) return;
-    vr->audio_ctx = avcodec_alloc_context3(codec);
-    avcodec_parameters_to_context(vr->audio_ctx, stream->codecpar);
-    if (avcodec_open2(vr->audio_ctx, (AVCodec*)codec, NULL) < 0) {
-        avcodec_free_context(&vr->audio_ctx);
-        vr->audio_ctx = NULL;
-        return;
-    }
-    vr->audio_time_base = stream->time_base;
-
-    SDL_AudioSpec want;
-    SDL_zero(want);
-    want.freq = vr->audio_ctx->sample_rate;
-    want.format = AUDIO_S16SYS;
-    want.channels = 2;
-    want.samples = 1024;
-    want.callback = NULL;
-    vr->audio_dev = SDL_OpenAudioDevice(NULL, 0, &want, &vr->audio_spec,
-                                         SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
-    if (vr->audio_dev) SDL_PauseAudioDevice(vr->audio_dev, 0);
-
-    AVChannelLayout in_layout = vr->audio_ctx->ch_layout;
-    AVChannelLayout out_layout;
-    av_channel_layout_default(&out_layout, 2);
-    swr_alloc_set_opts2(&vr->swr_ctx,
-        &out_layout, AV_SAMPLE_FMT_S16, vr->audio_spec.freq,
-        &in_layout, vr->audio_ctx->sample_fmt, vr->audio_ctx->sample_rate,
-        0, NULL);
-    swr_init(vr->swr_ctx);
-    vr->audio_frame = av_frame_alloc();
-}
-
 void vr_select_subtitle_track(VideoRenderer* vr, int idx) {
     if (!vr) return;
+    vr_seek_wait(vr);
 
     if (vr->subtitle_ctx) {
         avcodec_free_context(&vr->subtitle_ctx);
@@ -1057,7 +2383,10 @@ void vr_select_subtitle_track(VideoRenderer* vr, int idx) {
     if (vr->subtitle_texture) {
         SDL_DestroyTexture(vr->subtitle_texture);
         vr->subtitle_texture = NULL;
+        vr_account_video(vr);
     }
+    vr->active_subfile = NULL;
+    vr->subfile_attached = 0;
 
     if (idx < 0 || idx >= vr->subtitle_count) {
         vr->current_subtitle = -1;
@@ -1066,6 +2395,22 @@ void vr_select_subtitle_track(VideoRenderer* vr, int idx) {
         return;
     }
 
+    if (vr->subtitle_files[idx]) {
+        SubFile* sf = vr->subtitle_files[idx];
+        vr->subtitle_stream_index = -1;
+        vr->current_subtitle = idx;
+        vr->active_subfile = sf;
+        nob_log(NOB_INFO, "[SUBTITLE] Selected track %d: %s (file %s)", idx, vr->subtitle_names[idx], sf->path);
+        if (vr->ass_lib && vr->ass_renderer) {
+            vr->ass_track = ass_new_track(vr->ass_lib);
+            if (vr->ass_track) {
+                vr->ass_track->PlayResX = vr->width;
+                vr->ass_track->PlayResY = vr->height;
+            }
+        }
+        return;
+    }
+
     vr->subtitle_stream_index = vr->subtitle_streams[idx];
     vr->current_subtitle = idx;
 
@@ -1102,30 +2447,87 @@ void vr_select_subtitle_track(VideoRenderer* vr, int idx) {
         int64_t ts_us = (int64_t)(current_pos * AV_TIME_BASE);
         av_seek_frame(vr->fmt_ctx, -1, ts_us, AVSEEK_FLAG_BACKWARD);
         if (vr->subtitle_ctx) avcodec_flush_buffers(vr->subtitle_ctx);
-        if (vr->pending_valid) {
-            av_packet_unref(&vr->pending_pkt);
-            vr->pending_valid = 0;
-        }
     }
 }
 
+/* While paused: keeps the packet queues at their watermarks, the next
+ * picture decoded and, with `audio`, the audio ring at its target, so that
+ * resuming has sound and motion at once. Returns 1 while there is more to
+ * read. Not while stepping through a cached GOP, which resumes by seeking. */
+int vr_prime(VideoRenderer* vr, int audio) {
+    if (!vr || vr->seeking || vr->gop_pos >= 0 || vr->reversing) return 0;
+    int reads = vr_demux_packets(vr);
+    if (audio) vr_decode_audio(vr);
+    vr_decode_video(vr);
+    return reads > 0;
+}
+
+/* The first new picture after a resume has been presented. */
+void vr_note_presented(VideoRenderer* vr) {
+    if (!vr || !vr->resume_video_pending) return;
+    vr->resume_video_ms = (double)(amp_clock_now_ns() - vr->resume_ns) * 1e-6;
+    vr->resume_video_pending = 0;
+}
+
 void vr_set_paused(VideoRenderer* vr, int paused) {
-    if (!vr || !vr->audio_dev) return;
-    SDL_PauseAudioDevice(vr->audio_dev, paused ? 1 : 0);
-    if (paused && !vr->clock_paused) {
-        vr->clock_pause_ticks = SDL_GetTicks();
-        vr->clock_paused = 1;
-    } else if (!paused && vr->clock_paused) {
-        Uint32 now = SDL_GetTicks();
-        vr->clock_pause_accum += (now - vr->clock_pause_ticks);
-        vr->clock_paused = 0;
+    if (!vr) return;
+    amp_clock_set_paused(&vr->clock, paused);
+    int resuming = !paused && !vr->reversing;
+    vr->resume_ns = amp_clock_now_ns();
+    vr->resume_video_pending = resuming && vr->video_ctx;
+    if (vr->audio_dev) {
+        SDL_LockAudioDevice(vr->audio_dev);
+        vr->resume_audio_pending = resuming;
+        SDL_UnlockAudioDevice(vr->audio_dev);
     }
+    if (vr->reversing) {
+        vr->reverse_wall = amp_clock_now_ns() * 1e-9;
+        vr->reverse_media = vr->current_time;
+        return;
+    }
+    if (vr->audio_dev) SDL_PauseAudioDevice(vr->audio_dev, paused ? 1 : 0);
+    if (!paused) vr_gop_leave(vr);
+}
+
+/* While the window cannot be seen only audio is demuxed and decoded; video
+ * packets are dropped as they are read. Showing it again seeks to the
+ * current time in the configured seek mode to bring the picture back.
+ * The keyframe scan and storyboard fill wait until then too. Reverse
+ * playback, GOP stepping and loops keep decoding video. */
+void vr_set_hidden(VideoRenderer* vr, int hidden) {
+    if (!vr || !hidden == !vr->hidden) return;
+    if (hidden) {
+        if (!vr->video_ctx || vr->reversing || vr->gop_pos >= 0 || vr_get_loop(vr, NULL, NULL)) return;
+        vr_seek_wait(vr);
+        vr->hidden = 1;
+        pkt_queue_clear(&vr->video_pktq);
+        vr->frame_pending = 0;
+        if (vr->key_builder) SDL_AtomicSet(&vr->key_builder->paused, 1);
+        thumb_worker_set_paused(vr->thumbs, 1);
+        nob_log(NOB_INFO, "Window hidden, decoding audio only");
+        return;
+    }
+    vr->hidden = 0;
+    if (vr->key_builder) SDL_AtomicSet(&vr->key_builder->paused, 0);
+    thumb_worker_set_paused(vr->thumbs, 0);
+    double t = vr_get_time(vr);
+    nob_log(NOB_INFO, "Window shown, resyncing video at %.3fs", t);
+    vr_seek(vr, t);
 }
 
 void vr_free(VideoRenderer* vr) {
     if (!vr) return;
     vr_reset_stream(vr);
+    if (vr->seek_thread) {
+        SDL_LockMutex(vr->seek_lock);
+        vr->seek_quit = 1;
+        SDL_CondBroadcast(vr->seek_cond);
+        SDL_UnlockMutex(vr->seek_lock);
+        SDL_WaitThread(vr->seek_thread, NULL);
+    }
+    if (vr->seek_cond) SDL_DestroyCond(vr->seek_cond);
+    if (vr->seek_lock) SDL_DestroyMutex(vr->seek_lock);
     pkt_queue_free(&vr->video_pktq);
-    pkt_queue_free(&vr->audio_pktq);
+    pkt_queue_free(&vr->subtitle_pktq);
     free(vr);
 }
\ No newline at end of file
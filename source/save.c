@@ -22,6 +22,7 @@ typedef struct {
     int32_t subtitle_track;
     int audio_track_index;
     int subtitle_track_index;
+    KeyframeIndex key_index; /* stored in a trailing section, see write_save_state */
 } FileConfig;
 
 typedef struct {
@@ -57,6 +58,13 @@ void hash_file(const char* path, uint8_t out[HASH_SIZE]) {
     fclose(f);
 }
 
+/* Only scanned indexes are worth keeping; the container's own table comes
+ * back for free on the next open. Very long ones (all-intra files, which seek
+ * cheaply anyway) would bloat the file that is rewritten on every run. */
+static int save_keeps_key_index(const KeyframeIndex* ki) {
+    return ki->scanned && ki->count > 0 && ki->count <= SAVE_KEY_INDEX_MAX;
+}
+
 static int write_save_state(const char* path, SaveState* state) {
     if (!path || !state) return 0;
 
@@ -79,6 +87,18 @@ static int write_save_state(const char* path, SaveState* state) {
         total += sizeof(uint64_t) + (c->video_path ? strlen(c->video_path) : 0);
     }
 
+    /* Keyframe indexes follow the remembered files so older readers, which
+     * stop there, still accept the file. */
+    uint64_t index_count = 0;
+    total += sizeof(index_count);
+    for (uint64_t i = 0; i < state->remembered_count; i++) {
+        KeyframeIndex* ki = &state->remembered_files[i].key_index;
+        if (!save_keeps_key_index(ki)) continue;
+        index_count++;
+        total += HASH_SIZE + sizeof(ki->stream_index) + sizeof(int32_t) * 2 + sizeof(ki->count)
+               + (size_t)ki->count * sizeof(KeyframeEntry);
+    }
+
     uint8_t* buf = malloc(total);
     if (!buf) return 0;
 
@@ -117,6 +137,19 @@ static int write_save_state(const char* path, SaveState* state) {
         if (len) { memcpy(ptr, c->video_path, len); ptr += len; }
     }
 
+    memcpy(ptr, &index_count, sizeof(index_count)); ptr += sizeof(index_count);
+    for (uint64_t i = 0; i < state->remembered_count; i++) {
+        FileConfig* c = &state->remembered_files[i];
+        KeyframeIndex* ki = &c->key_index;
+        if (!save_keeps_key_index(ki)) continue;
+        int32_t tb[2] = { ki->time_base.num, ki->time_base.den };
+        memcpy(ptr, c->file_hash, HASH_SIZE); ptr += HASH_SIZE;
+        memcpy(ptr, &ki->stream_index, sizeof(ki->stream_index)); ptr += sizeof(ki->stream_index);
+        memcpy(ptr, tb, sizeof(tb)); ptr += sizeof(tb);
+        memcpy(ptr, &ki->count, sizeof(ki->count)); ptr += sizeof(ki->count);
+        memcpy(ptr, ki->entries, (size_t)ki->count * sizeof(KeyframeEntry)); ptr += (size_t)ki->count * sizeof(KeyframeEntry);
+    }
+
     FILE* f = fopen(path, "wb");
     if (!f) { free(buf); return 0; }
     size_t written = fwrite(buf, 1, total, f);
@@ -194,6 +227,36 @@ static int load_save_state(const char* path, SaveState* s) {
         } else c->video_path = NULL;
     }
 
+    uint8_t* end = buf + size;
+    uint64_t index_count = 0;
+    if (end - ptr >= (ptrdiff_t)sizeof(index_count)) {
+        memcpy(&index_count, ptr, sizeof(index_count)); ptr += sizeof(index_count);
+    }
+    for (uint64_t i = 0; i < index_count; i++) {
+        uint8_t hash[HASH_SIZE];
+        int32_t stream_index, tb[2];
+        int64_t count;
+        if (end - ptr < (ptrdiff_t)(HASH_SIZE + sizeof(stream_index) + sizeof(tb) + sizeof(count))) break;
+        memcpy(hash, ptr, HASH_SIZE); ptr += HASH_SIZE;
+        memcpy(&stream_index, ptr, sizeof(stream_index)); ptr += sizeof(stream_index);
+        memcpy(tb, ptr, sizeof(tb)); ptr += sizeof(tb);
+        memcpy(&count, ptr, sizeof(count)); ptr += sizeof(count);
+        if (count <= 0 || (uint64_t)(end - ptr) / sizeof(KeyframeEntry) < (uint64_t)count) break;
+        for (uint64_t j = 0; count <= SAVE_KEY_INDEX_MAX && j < s->remembered_count; j++) {
+            FileConfig* c = &s->remembered_files[j];
+            if (c->key_index.count > 0 || memcmp(c->file_hash, hash, HASH_SIZE) != 0) continue;
+            c->key_index.entries = malloc((size_t)count * sizeof(KeyframeEntry));
+            if (!c->key_index.entries) break;
+            memcpy(c->key_index.entries, ptr, (size_t)count * sizeof(KeyframeEntry));
+            c->key_index.count = c->key_index.capacity = count;
+            c->key_index.stream_index = stream_index;
+            c->key_index.time_base = (AVRational){ tb[0], tb[1] };
+            c->key_index.scanned = 1;
+            break;
+        }
+        ptr += (size_t)count * sizeof(KeyframeEntry);
+    }
+
     free(buf);
     return 1;
 }
@@ -227,6 +290,10 @@ static void fill_save_state_from_vr_idx(VideoRenderer* vr, SaveState* state, int
         existing->subtitle_track = vr->current_subtitle;
         existing->audio_track_index = vr->audio_stream_index;
         existing->subtitle_track_index = vr->subtitle_stream_index;
+        if (existing->key_index.count > 0 && vr->key_index.count == 0)
+            vr_adopt_key_index(vr, &existing->key_index);
+        else if (existing->key_index.count == 0 && save_keeps_key_index(&vr->key_index))
+            key_index_copy(&existing->key_index, &vr->key_index);
     }
 }
 
@@ -251,6 +318,7 @@ static void fill_save_state_from_vr(VideoRenderer* vr, SaveState* state, const c
         config.subtitle_track = vr->current_subtitle;
         config.audio_track_index = vr->audio_stream_index;
         config.subtitle_track_index = vr->subtitle_stream_index;
+        if (save_keeps_key_index(&vr->key_index)) key_index_copy(&config.key_index, &vr->key_index);
 
         FileConfig* tmp = realloc(state->remembered_files, (state->remembered_count + 1) * sizeof(FileConfig));
         if (tmp) {
@@ -259,6 +327,7 @@ static void fill_save_state_from_vr(VideoRenderer* vr, SaveState* state, const c
             state->remembered_count += 1;
         } else {
             free(config.video_path);
+            key_index_free(&config.key_index);
         }
     }
 }
@@ -272,6 +341,7 @@ static void apply_save_state_to_vr(VideoRenderer* vr, SaveState* state, const ch
             if (state->remembered_files[i].subtitle_track >= -1)
                 vr_select_subtitle_track(vr, state->remembered_files[i].subtitle_track);
 
+            vr_adopt_key_index(vr, &state->remembered_files[i].key_index);
             vr_set_speed(vr, state->remembered_files[i].playback_speed);
             vr_set_volume(vr, state->remembered_files[i].volume_percent / 100.0f);
 
@@ -286,6 +356,7 @@ static void free_save_state(SaveState* state) {
     if (!state) return;
     for (uint64_t i = 0; i < state->remembered_count; i++) {
         if (state->remembered_files[i].video_path) free(state->remembered_files[i].video_path);
+        key_index_free(&state->remembered_files[i].key_index);
     }
     if (state->remembered_files) free(state->remembered_files);
     state->remembered_files = NULL;
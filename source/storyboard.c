@@ -0,0 +1,338 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <utime.h>
+#include "../thirdparty/nob.h"
+#include "../thirdparty/libavformat/avio.h"
+#include "../thirdparty/libavcodec/avcodec.h"
+#include "../thirdparty/libswscale/swscale.h"
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#define STORYBOARD_MAGIC 0x42534D41 /* 'AMSB' */
+#define STORYBOARD_VERSION 1
+#define STORYBOARD_FINGERPRINT_BYTES (64 * 1024)
+#define STORYBOARD_JPEG_QUALITY 5 /* mjpeg qscale, lower is better */
+
+enum { STORYBOARD_TILE_PRESENT = 1, STORYBOARD_TILE_FAILED = 2 };
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t fingerprint;
+    uint32_t interval_ms;
+    uint16_t tile_w;
+    uint16_t tile_h;
+    uint32_t count;
+    uint32_t reserved;
+} StoryboardHeader;
+
+typedef struct {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t flags;
+} StoryboardSlot;
+
+/* Fixed-interval thumbnails for one file: a header, a slot per interval and
+ * the JPEG tiles appended after them. The file is mapped read-only when it is
+ * opened; tiles written since are read back through `file`. Only the
+ * thumbnail worker touches it. */
+typedef struct {
+    FILE* file;
+    char path[512];
+    StoryboardHeader header;
+    StoryboardSlot* slots;
+    uint8_t* map;
+    size_t map_size;
+    int mapped;
+    uint8_t* scratch;
+    size_t scratch_size;
+    int64_t present;
+    int evicted;           /* older storyboards deleted to make room for this one */
+    int pass_stride;       /* coarse-to-fine fill: every Nth tile, halving */
+    int64_t pass_pos;
+    AVCodecContext* enc;
+    AVCodecContext* dec;
+    AVFrame* yuv;
+    AVPacket* pkt;
+    struct SwsContext* to_yuv;
+    struct SwsContext* to_rgba;
+} Storyboard;
+
+/* Cheap identity for a media file: its size and the bytes at both ends.
+ * Hashing the whole file, as the save file does, would cost a full read. */
+static int storyboard_fingerprint(const char* path, uint64_t* out) {
+    AVIOContext* pb = NULL;
+    if (avio_open(&pb, path, AVIO_FLAG_READ) < 0) return 0;
+    int64_t size = avio_size(pb);
+    uint64_t h = 1469598103934665603ULL;
+    for (int i = 0; i < 8; i++) h = (h ^ (uint8_t)((uint64_t)size >> (i * 8))) * 1099511628211ULL;
+    uint8_t* buf = (uint8_t*)malloc(STORYBOARD_FINGERPRINT_BYTES);
+    for (int part = 0; buf && part < 2; part++) {
+        int64_t at = part == 0 ? 0 : size - STORYBOARD_FINGERPRINT_BYTES;
+        if (at < 0) at = 0;
+        if (avio_seek(pb, at, SEEK_SET) < 0) continue;
+        int n = avio_read(pb, buf, STORYBOARD_FINGERPRINT_BYTES);
+        for (int i = 0; i < n; i++) h = (h ^ buf[i]) * 1099511628211ULL;
+    }
+    free(buf);
+    avio_closep(&pb);
+    *out = h;
+    return size > 0;
+}
+
+/* Deletes the least recently used storyboards until the directory fits in
+ * STORYBOARD_MAX_BYTES, keeping `keep`, and returns how many it deleted.
+ * Use time is the file's mtime, which storyboard_open refreshes. */
+static int storyboard_evict(const char* keep) {
+    typedef struct { char name[256]; int64_t size; time_t used; } Item;
+    Item* items = NULL;
+    int count = 0, cap = 0;
+    int64_t total = 0;
+    int evicted = 0;
+    DIR* dir = opendir(STORYBOARD_DIR);
+    if (!dir) return 0;
+    struct dirent* de;
+    while ((de = readdir(dir)) != NULL) {
+        size_t len = strlen(de->d_name);
+        if (len < 4 || len >= sizeof(items[0].name) || strcmp(de->d_name + len - 3, ".sb") != 0) continue;
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", STORYBOARD_DIR, de->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0) continue;
+        if (count == cap) {
+            cap = cap ? cap * 2 : 32;
+            Item* grown = (Item*)realloc(items, (size_t)cap * sizeof(Item));
+            if (!grown) break;
+            items = grown;
+        }
+        memcpy(items[count].name, de->d_name, len + 1);
+        items[count].size = st.st_size;
+        items[count].used = st.st_mtime;
+        total += st.st_size;
+        count++;
+    }
+    closedir(dir);
+
+    while (total > STORYBOARD_MAX_BYTES) {
+        int oldest = -1;
+        for (int i = 0; i < count; i++) {
+            if (items[i].size < 0 || strcmp(items[i].name, keep) == 0) continue;
+            if (oldest < 0 || items[i].used < items[oldest].used) oldest = i;
+        }
+        if (oldest < 0) break;
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", STORYBOARD_DIR, items[oldest].name);
+        if (remove(path) == 0) evicted++;
+        total -= items[oldest].size;
+        items[oldest].size = -1;
+    }
+    free(items);
+    return evicted;
+}
+
+static int storyboard_open_codecs(Storyboard* sb) {
+    const AVCodec* enc = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+    const AVCodec* dec = avcodec_find_decoder(AV_CODEC_ID_MJPEG);
+    if (!enc || !dec) return 0;
+    sb->enc = avcodec_alloc_context3(enc);
+    sb->dec = avcodec_alloc_context3(dec);
+    sb->yuv = av_frame_alloc();
+    sb->pkt = av_packet_alloc();
+    if (!sb->enc || !sb->dec || !sb->yuv || !sb->pkt) return 0;
+    sb->enc->width = sb->header.tile_w;
+    sb->enc->height = sb->header.tile_h;
+    sb->enc->pix_fmt = AV_PIX_FMT_YUVJ420P;
+    sb->enc->time_base = (AVRational){ 1, 25 };
+    sb->enc->flags |= AV_CODEC_FLAG_QSCALE;
+    sb->enc->global_quality = FF_QP2LAMBDA * STORYBOARD_JPEG_QUALITY;
+    sb->enc->thread_count = 1;
+    sb->dec->thread_count = 1;
+    if (avcodec_open2(sb->enc, enc, NULL) < 0 || avcodec_open2(sb->dec, dec, NULL) < 0) return 0;
+    sb->yuv->format = AV_PIX_FMT_YUVJ420P;
+    sb->yuv->width = sb->header.tile_w;
+    sb->yuv->height = sb->header.tile_h;
+    if (av_frame_get_buffer(sb->yuv, 0) < 0) return 0;
+    sb->to_yuv = sws_getContext(sb->header.tile_w, sb->header.tile_h, AV_PIX_FMT_RGBA,
+                                sb->header.tile_w, sb->header.tile_h, AV_PIX_FMT_YUVJ420P,
+                                SWS_BILINEAR, NULL, NULL, NULL);
+    return sb->to_yuv != NULL;
+}
+
+static void storyboard_close(Storyboard* sb) {
+    if (!sb) return;
+#ifndef _WIN32
+    if (sb->map && sb->mapped) munmap(sb->map, sb->map_size);
+    else free(sb->map);
+#else
+    free(sb->map);
+#endif
+    if (sb->file) fclose(sb->file);
+    free(sb->slots);
+    free(sb->scratch);
+    avcodec_free_context(&sb->enc);
+    avcodec_free_context(&sb->dec);
+    av_frame_free(&sb->yuv);
+    av_packet_free(&sb->pkt);
+    sws_freeContext(sb->to_yuv);
+    sws_freeContext(sb->to_rgba);
+    free(sb);
+}
+
+/* Maps the whole file, or reads it where mmap is not available. */
+static void storyboard_map(Storyboard* sb) {
+    fseek(sb->file, 0, SEEK_END);
+    long size = ftell(sb->file);
+    if (size <= 0) return;
+    sb->map_size = (size_t)size;
+#ifndef _WIN32
+    void* p = mmap(NULL, sb->map_size, PROT_READ, MAP_PRIVATE, fileno(sb->file), 0);
+    if (p != MAP_FAILED) {
+        sb->map = (uint8_t*)p;
+        sb->mapped = 1;
+        return;
+    }
+#endif
+    sb->map = (uint8_t*)malloc(sb->map_size);
+    fseek(sb->file, 0, SEEK_SET);
+    if (sb->map && fread(sb->map, 1, sb->map_size, sb->file) != sb->map_size) {
+        free(sb->map);
+        sb->map = NULL;
+    }
+    if (!sb->map) sb->map_size = 0;
+}
+
+/* Opens the storyboard for `fingerprint`, starting a fresh one when none
+ * exists or the stored geometry differs. */
+static Storyboard* storyboard_open(uint64_t fingerprint, double interval, int tile_w, int tile_h, int64_t count) {
+    if (count <= 0 || count > UINT32_MAX / 2 || !nob_mkdir_if_not_exists(STORYBOARD_DIR)) return NULL;
+    Storyboard* sb = (Storyboard*)calloc(1, sizeof(Storyboard));
+    if (!sb) return NULL;
+    char name[64];
+    snprintf(name, sizeof(name), "%016llx.sb", (unsigned long long)fingerprint);
+    snprintf(sb->path, sizeof(sb->path), "%s/%s", STORYBOARD_DIR, name);
+    StoryboardHeader want = { STORYBOARD_MAGIC, STORYBOARD_VERSION, fingerprint, (uint32_t)(interval * 1000.0),
+                              (uint16_t)tile_w, (uint16_t)tile_h, (uint32_t)count, 0 };
+    sb->header = want;
+    sb->slots = (StoryboardSlot*)calloc((size_t)count, sizeof(StoryboardSlot));
+    if (!sb->slots || !storyboard_open_codecs(sb)) {
+        storyboard_close(sb);
+        return NULL;
+    }
+
+    sb->file = fopen(sb->path, "r+b");
+    if (sb->file) {
+        StoryboardHeader have;
+        if (fread(&have, sizeof(have), 1, sb->file) != 1 || memcmp(&have, &want, sizeof(want)) != 0
+            || fread(sb->slots, sizeof(StoryboardSlot), (size_t)count, sb->file) != (size_t)count) {
+            fclose(sb->file);
+            sb->file = NULL;
+            memset(sb->slots, 0, (size_t)count * sizeof(StoryboardSlot));
+        }
+    }
+    if (!sb->file) {
+        sb->file = fopen(sb->path, "w+b");
+        if (!sb->file || fwrite(&want, sizeof(want), 1, sb->file) != 1
+            || fwrite(sb->slots, sizeof(StoryboardSlot), (size_t)count, sb->file) != (size_t)count) {
+            nob_log(NOB_WARNING, "Cannot write storyboard %s", sb->path);
+            storyboard_close(sb);
+            return NULL;
+        }
+        fflush(sb->file);
+    }
+    utime(sb->path, NULL);
+    storyboard_map(sb);
+    for (int64_t i = 0; i < count; i++) {
+        if (sb->slots[i].flags) sb->present++;
+    }
+    sb->pass_stride = 64;
+    sb->evicted = storyboard_evict(name);
+    return sb;
+}
+
+/* Next tile to generate: every 64th interval first, then every 32nd and so
+ * on, so the whole timeline gets coarse coverage early. -1 when complete. */
+static int64_t storyboard_next_missing(Storyboard* sb) {
+    int64_t count = sb->header.count;
+    while (sb->pass_stride > 0) {
+        for (; sb->pass_pos < count; sb->pass_pos += sb->pass_stride) {
+            if (!sb->slots[sb->pass_pos].flags) return sb->pass_pos;
+        }
+        sb->pass_stride /= 2;
+        sb->pass_pos = 0;
+    }
+    return -1;
+}
+
+/* Compresses an RGBA tile and appends it. NULL records a failed decode so
+ * it is not retried. */
+static void storyboard_put(Storyboard* sb, int64_t index, const uint8_t* rgba) {
+    if (index < 0 || index >= sb->header.count || sb->slots[index].flags) return;
+    StoryboardSlot slot = { 0, 0, STORYBOARD_TILE_FAILED };
+    if (rgba && av_frame_make_writable(sb->yuv) >= 0) {
+        const uint8_t* src[4] = { rgba, NULL, NULL, NULL };
+        int stride[4] = { sb->header.tile_w * 4, 0, 0, 0 };
+        sws_scale(sb->to_yuv, src, stride, 0, sb->header.tile_h, sb->yuv->data, sb->yuv->linesize);
+        if (avcodec_send_frame(sb->enc, sb->yuv) >= 0 && avcodec_receive_packet(sb->enc, sb->pkt) >= 0) {
+            fseek(sb->file, 0, SEEK_END);
+            slot.offset = (uint64_t)ftell(sb->file);
+            slot.size = (uint32_t)sb->pkt->size;
+            slot.flags = STORYBOARD_TILE_PRESENT;
+            if (fwrite(sb->pkt->data, 1, (size_t)sb->pkt->size, sb->file) != (size_t)sb->pkt->size) slot.flags = 0;
+            av_packet_unref(sb->pkt);
+        }
+    }
+    if (!slot.flags) return;
+    fflush(sb->file); /* tile lands before the slot pointing at it */
+    sb->slots[index] = slot;
+    fseek(sb->file, (long)(sizeof(StoryboardHeader) + (size_t)index * sizeof(StoryboardSlot)), SEEK_SET);
+    fwrite(&slot, sizeof(slot), 1, sb->file);
+    fflush(sb->file);
+    sb->present++;
+}
+
+/* Decodes tile `index` into `rgba` (tile_w * tile_h * 4 bytes). Returns 1 on
+ * success, -1 for a tile recorded as failed and 0 when it is not cached. */
+static int storyboard_get(Storyboard* sb, int64_t index, uint8_t* rgba) {
+    if (index < 0 || index >= sb->header.count) return -1;
+    StoryboardSlot slot = sb->slots[index];
+    if (!slot.flags) return 0;
+    if (slot.flags & STORYBOARD_TILE_FAILED) return -1;
+
+    const uint8_t* data = NULL;
+    if (slot.offset + slot.size <= sb->map_size) {
+        data = sb->map + slot.offset;
+    } else {
+        if (sb->scratch_size < slot.size) {
+            uint8_t* grown = (uint8_t*)realloc(sb->scratch, slot.size);
+            if (!grown) return 0;
+            sb->scratch = grown;
+            sb->scratch_size = slot.size;
+        }
+        fseek(sb->file, (long)slot.offset, SEEK_SET);
+        if (fread(sb->scratch, 1, slot.size, sb->file) != slot.size) return 0;
+        data = sb->scratch;
+    }
+
+    if (av_new_packet(sb->pkt, (int)slot.size) < 0) return 0;
+    memcpy(sb->pkt->data, data, slot.size);
+    int ok = avcodec_send_packet(sb->dec, sb->pkt) >= 0;
+    av_packet_unref(sb->pkt);
+    AVFrame* frame = av_frame_alloc();
+    ok = ok && frame && avcodec_receive_frame(sb->dec, frame) >= 0;
+    if (ok) {
+        sb->to_rgba = sws_getCachedContext(sb->to_rgba, frame->width, frame->height, frame->format,
+                                           sb->header.tile_w, sb->header.tile_h, AV_PIX_FMT_RGBA,
+                                           SWS_BILINEAR, NULL, NULL, NULL);
+        uint8_t* dst[4] = { rgba, NULL, NULL, NULL };
+        int stride[4] = { sb->header.tile_w * 4, 0, 0, 0 };
+        ok = sb->to_rgba && sws_scale(sb->to_rgba, (const uint8_t* const*)frame->data, frame->linesize,
+                                      0, frame->height, dst, stride) > 0;
+    }
+    av_frame_free(&frame);
+    return ok ? 1 : 0;
+}
@@ -0,0 +1,409 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../thirdparty/nob.h"
+#include "../thirdparty/SDL2/SDL.h"
+#include "../thirdparty/ass/ass.h"
+
+#define SUBFILE_FEED_AHEAD_MS 10000
+
+typedef enum {
+    SUBFILE_SRT,
+    SUBFILE_ASS,
+    SUBFILE_VTT,
+} SubFileFormat;
+
+typedef struct {
+    int64_t start_ms;
+    int64_t duration_ms;
+    int order;
+    char* fields; /* "Layer,Style,Name,MarginL,MarginR,MarginV,Effect,Text" */
+} SubEvent;
+
+typedef struct {
+    SubEvent* items;
+    size_t count;
+    size_t capacity;
+} SubEvents;
+
+/* A sidecar subtitle file. It is parsed once on a worker thread into a
+ * start-sorted event table; the main thread then feeds libass a window of
+ * events around the playback position, so seeking is a binary search. */
+typedef struct {
+    char* path;
+    SubFileFormat format;
+    SDL_Thread* thread;
+    SDL_atomic_t state; /* 0 parsing, 1 ready, -1 failed */
+
+    Nob_String_Builder header;
+    SubEvents events;
+    int64_t max_duration_ms;
+
+    size_t next;
+    Nob_String_Builder chunk;
+} SubFile;
+
+static const char* SUBFILE_DEFAULT_HEADER =
+    "[Script Info]\n"
+    "ScriptType: v4.00+\n"
+    "PlayResX: 384\n"
+    "PlayResY: 288\n"
+    "ScaledBorderAndShadow: yes\n"
+    "\n"
+    "[V4+ Styles]\n"
+    "Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, OutlineColour, BackColour, "
+    "Bold, Italic, Underline, StrikeOut, ScaleX, ScaleY, Spacing, Angle, BorderStyle, Outline, "
+    "Shadow, Alignment, MarginL, MarginR, MarginV, Encoding\n"
+    "Style: Default,Arial,16,&Hffffff,&Hffffff,&H0,&H0,0,0,0,0,100,100,0,0,1,1,0,2,10,10,10,0\n"
+    "\n"
+    "[Events]\n"
+    "Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\n";
+
+static int subtitle_has_prefix(const char* s, size_t len, const char* prefix) {
+    size_t n = strlen(prefix);
+    return len >= n && memcmp(s, prefix, n) == 0;
+}
+
+/* Appends plain subtitle text as ASS event text. Newlines become \N; with
+ * `markup` set, the common SRT/WebVTT tags and entities are translated and
+ * unknown tags dropped, otherwise '{' is escaped so it is not read as an
+ * override block. */
+static void subtitle_append_ass_text(Nob_String_Builder* sb, const char* text, size_t len, int markup) {
+    static const struct { const char* tag; const char* ass; } tags[] = {
+        { "<i>", "{\\i1}" }, { "</i>", "{\\i0}" },
+        { "<b>", "{\\b1}" }, { "</b>", "{\\b0}" },
+        { "<u>", "{\\u1}" }, { "</u>", "{\\u0}" },
+        { "<s>", "{\\s1}" }, { "</s>", "{\\s0}" },
+    };
+    static const struct { const char* name; char c; } entities[] = {
+        { "&amp;", '&' }, { "&lt;", '<' }, { "&gt;", '>' }, { "&nbsp;", ' ' },
+    };
+
+    size_t i = 0;
+    while (i < len) {
+        char c = text[i];
+        if (c == '\r') { i++; continue; }
+        if (c == '\n') {
+            nob_sb_append_buf(sb, "\\N", 2);
+            i++;
+            continue;
+        }
+        if (!markup) {
+            if (c == '{') nob_sb_append_buf(sb, "\\{", 2);
+            else nob_sb_append(sb, c);
+            i++;
+            continue;
+        }
+        if (c == '<') {
+            size_t k = 0;
+            for (; k < NOB_ARRAY_LEN(tags); k++) {
+                if (subtitle_has_prefix(text + i, len - i, tags[k].tag)) break;
+            }
+            if (k < NOB_ARRAY_LEN(tags)) {
+                nob_sb_append_cstr(sb, tags[k].ass);
+                i += strlen(tags[k].tag);
+                continue;
+            }
+            const char* close = memchr(text + i, '>', len - i);
+            if (close) {
+                i = (size_t)(close - text) + 1;
+                continue;
+            }
+        }
+        if (c == '&') {
+            size_t k = 0;
+            for (; k < NOB_ARRAY_LEN(entities); k++) {
+                if (subtitle_has_prefix(text + i, len - i, entities[k].name)) break;
+            }
+            if (k < NOB_ARRAY_LEN(entities)) {
+                nob_sb_append(sb, entities[k].c);
+                i += strlen(entities[k].name);
+                continue;
+            }
+        }
+        nob_sb_append(sb, c);
+        i++;
+    }
+}
+
+/* Parses "H:MM:SS,mmm", "HH:MM:SS.mmm", "MM:SS.mmm" or ASS "H:MM:SS.cc".
+ * Returns the number of characters consumed, 0 on failure. */
+static size_t subtitle_parse_timestamp(const char* s, size_t len, int64_t* out_ms) {
+    int64_t parts[3] = {0};
+    int nparts = 0;
+    size_t i = 0;
+    while (i < len && s[i] == ' ') i++;
+    for (;;) {
+        size_t start = i;
+        int64_t v = 0;
+        while (i < len && s[i] >= '0' && s[i] <= '9') v = v * 10 + (s[i++] - '0');
+        if (i == start || nparts == 3) return 0;
+        parts[nparts++] = v;
+        if (i < len && s[i] == ':') { i++; continue; }
+        break;
+    }
+    if (nparts < 2) return 0;
+
+    int64_t frac_ms = 0;
+    if (i < len && (s[i] == ',' || s[i] == '.')) {
+        i++;
+        int digits = 0;
+        int64_t frac = 0;
+        while (i < len && s[i] >= '0' && s[i] <= '9') {
+            if (digits < 3) { frac = frac * 10 + (s[i] - '0'); digits++; }
+            i++;
+        }
+        while (digits > 0 && digits < 3) { frac *= 10; digits++; }
+        frac_ms = frac;
+    }
+
+    int64_t h = nparts == 3 ? parts[0] : 0;
+    int64_t m = parts[nparts - 2];
+    int64_t sec = parts[nparts - 1];
+    *out_ms = ((h * 60 + m) * 60 + sec) * 1000 + frac_ms;
+    return i;
+}
+
+static void subfile_push_event(SubFile* sf, int64_t start_ms, int64_t end_ms, Nob_String_Builder* fields) {
+    if (end_ms <= start_ms) end_ms = start_ms + 1;
+    SubEvent ev = {0};
+    ev.start_ms = start_ms;
+    ev.duration_ms = end_ms - start_ms;
+    ev.order = (int)sf->events.count;
+    ev.fields = malloc(fields->count + 1);
+    if (!ev.fields) return;
+    memcpy(ev.fields, fields->items, fields->count);
+    ev.fields[fields->count] = '\0';
+    nob_da_append(&sf->events, ev);
+    if (ev.duration_ms > sf->max_duration_ms) sf->max_duration_ms = ev.duration_ms;
+}
+
+/* SRT and WebVTT share the cue layout: an optional id line, a timing line
+ * with "-->", then text lines up to a blank line. */
+static void subfile_parse_cues(SubFile* sf, const char* data, size_t size) {
+    Nob_String_Builder text = {0};
+    Nob_String_Builder fields = {0};
+    int in_cue = 0;
+    int skip_block = 0;
+    int64_t start_ms = 0, end_ms = 0;
+
+    size_t pos = 0;
+    while (pos <= size) {
+        const char* line = data + pos;
+        const char* nl = memchr(line, '\n', size - pos);
+        size_t len = nl ? (size_t)(nl - line) : size - pos;
+        pos += len + 1;
+        if (len > 0 && line[len - 1] == '\r') len--;
+
+        if (len == 0) {
+            if (in_cue) {
+                fields.count = 0;
+                nob_sb_append_cstr(&fields, "0,Default,,0,0,0,,");
+                subtitle_append_ass_text(&fields, text.items, text.count, 1);
+                subfile_push_event(sf, start_ms, end_ms, &fields);
+            }
+            in_cue = 0;
+            skip_block = 0;
+            text.count = 0;
+            if (!nl) break;
+            continue;
+        }
+        if (skip_block) continue;
+
+        if (in_cue) {
+            if (text.count > 0) nob_sb_append(&text, '\n');
+            nob_sb_append_buf(&text, line, len);
+            continue;
+        }
+
+        if (sf->format == SUBFILE_VTT
+            && (subtitle_has_prefix(line, len, "WEBVTT")
+                || subtitle_has_prefix(line, len, "NOTE")
+                || subtitle_has_prefix(line, len, "STYLE")
+                || subtitle_has_prefix(line, len, "REGION"))) {
+            skip_block = 1;
+            continue;
+        }
+
+        const char* arrow = NULL;
+        for (size_t i = 0; i + 3 <= len; i++) {
+            if (memcmp(line + i, "-->", 3) == 0) { arrow = line + i; break; }
+        }
+        if (!arrow) continue;
+
+        size_t left = (size_t)(arrow - line);
+        if (!subtitle_parse_timestamp(line, left, &start_ms)) continue;
+        if (!subtitle_parse_timestamp(arrow + 3, len - left - 3, &end_ms)) continue;
+        in_cue = 1;
+    }
+    if (in_cue && text.count > 0) {
+        fields.count = 0;
+        nob_sb_append_cstr(&fields, "0,Default,,0,0,0,,");
+        subtitle_append_ass_text(&fields, text.items, text.count, 1);
+        subfile_push_event(sf, start_ms, end_ms, &fields);
+    }
+
+    nob_sb_free(text);
+    nob_sb_free(fields);
+}
+
+/* Everything outside the [Events] dialogue lines becomes the codec-private
+ * header; each Dialogue line is re-cut into the libass chunk layout. */
+static void subfile_parse_ass(SubFile* sf, const char* data, size_t size) {
+    Nob_String_Builder fields = {0};
+    int in_events = 0;
+
+    size_t pos = 0;
+    while (pos < size) {
+        const char* line = data + pos;
+        const char* nl = memchr(line, '\n', size - pos);
+        size_t len = nl ? (size_t)(nl - line) : size - pos;
+        pos += len + 1;
+        if (len > 0 && line[len - 1] == '\r') len--;
+
+        if (len > 0 && line[0] == '[') {
+            in_events = subtitle_has_prefix(line, len, "[Events]");
+        }
+        if (!in_events || !subtitle_has_prefix(line, len, "Dialogue:")) {
+            if (!in_events || subtitle_has_prefix(line, len, "Format:") || line[0] == '[') {
+                nob_sb_append_buf(&sf->header, line, len);
+                nob_sb_append(&sf->header, '\n');
+            }
+            continue;
+        }
+
+        const char* p = line + strlen("Dialogue:");
+        const char* end = line + len;
+        while (p < end && *p == ' ') p++;
+
+        const char* field[3];
+        size_t field_len[3];
+        int ok = 1;
+        for (int f = 0; f < 3; f++) {
+            const char* comma = memchr(p, ',', (size_t)(end - p));
+            if (!comma) { ok = 0; break; }
+            field[f] = p;
+            field_len[f] = (size_t)(comma - p);
+            p = comma + 1;
+        }
+        if (!ok) continue;
+
+        int64_t start_ms = 0, end_ms = 0;
+        if (!subtitle_parse_timestamp(field[1], field_len[1], &start_ms)) continue;
+        if (!subtitle_parse_timestamp(field[2], field_len[2], &end_ms)) continue;
+
+        fields.count = 0;
+        if (subtitle_has_prefix(field[0], field_len[0], "Marked=")) nob_sb_append(&fields, '0');
+        else nob_sb_append_buf(&fields, field[0], field_len[0]);
+        nob_sb_append(&fields, ',');
+        nob_sb_append_buf(&fields, p, (size_t)(end - p));
+        subfile_push_event(sf, start_ms, end_ms, &fields);
+    }
+
+    nob_sb_free(fields);
+}
+
+static int subfile_event_cmp(const void* a, const void* b) {
+    const SubEvent* ea = (const SubEvent*)a;
+    const SubEvent* eb = (const SubEvent*)b;
+    if (ea->start_ms != eb->start_ms) return ea->start_ms < eb->start_ms ? -1 : 1;
+    return ea->order - eb->order;
+}
+
+static int subfile_thread(void* userdata) {
+    SubFile* sf = (SubFile*)userdata;
+
+    FILE* f = fopen(sf->path, "rb");
+    if (!f) { SDL_AtomicSet(&sf->state, -1); return 0; }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* data = size > 0 ? malloc((size_t)size) : NULL;
+    size_t n = data ? fread(data, 1, (size_t)size, f) : 0;
+    fclose(f);
+    if (!data || n == 0) { free(data); SDL_AtomicSet(&sf->state, -1); return 0; }
+
+    const char* text = data;
+    if (n >= 3 && (uint8_t)text[0] == 0xEF && (uint8_t)text[1] == 0xBB && (uint8_t)text[2] == 0xBF) {
+        text += 3;
+        n -= 3;
+    }
+
+    if (sf->format == SUBFILE_ASS) {
+        subfile_parse_ass(sf, text, n);
+    } else {
+        nob_sb_append_cstr(&sf->header, SUBFILE_DEFAULT_HEADER);
+        subfile_parse_cues(sf, text, n);
+    }
+    free(data);
+
+    if (sf->events.count > 1) qsort(sf->events.items, sf->events.count, sizeof(SubEvent), subfile_event_cmp);
+    for (size_t i = 0; i < sf->events.count; i++) sf->events.items[i].order = (int)i;
+
+    SDL_AtomicSet(&sf->state, sf->events.count > 0 ? 1 : -1);
+    return 0;
+}
+
+static SubFile* subfile_open_async(const char* path, SubFileFormat format) {
+    SubFile* sf = (SubFile*)calloc(1, sizeof(SubFile));
+    if (!sf) return NULL;
+    sf->path = strdup(path);
+    sf->format = format;
+    SDL_AtomicSet(&sf->state, 0);
+    sf->thread = SDL_CreateThread(subfile_thread, "amp-subfile", sf);
+    if (!sf->thread) {
+        subfile_thread(sf);
+    }
+    return sf;
+}
+
+static int subfile_ready(SubFile* sf) {
+    return sf && SDL_AtomicGet(&sf->state) == 1;
+}
+
+static void subfile_free(SubFile* sf) {
+    if (!sf) return;
+    if (sf->thread) SDL_WaitThread(sf->thread, NULL);
+    for (size_t i = 0; i < sf->events.count; i++) free(sf->events.items[i].fields);
+    nob_da_free(sf->events);
+    nob_sb_free(sf->header);
+    nob_sb_free(sf->chunk);
+    free(sf->path);
+    free(sf);
+}
+
+/* Loads the style header into a fresh track. Must only be called once the
+ * file is ready. */
+static void subfile_attach(SubFile* sf, ASS_Track* track) {
+    if (!subfile_ready(sf) || !track || sf->header.count == 0) return;
+    ass_process_codec_private(track, sf->header.items, (int)sf->header.count);
+    sf->next = 0;
+}
+
+/* Drops the events libass holds and repositions the feed cursor on the first
+ * event that can still be visible at `ms`. */
+static void subfile_seek(SubFile* sf, ASS_Track* track, int64_t ms) {
+    if (!subfile_ready(sf)) return;
+    if (track) ass_flush_events(track);
+    int64_t from = ms - sf->max_duration_ms;
+    size_t lo = 0, hi = sf->events.count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (sf->events.items[mid].start_ms < from) lo = mid + 1;
+        else hi = mid;
+    }
+    sf->next = lo;
+}
+
+static void subfile_feed(SubFile* sf, ASS_Track* track, int64_t ms) {
+    if (!subfile_ready(sf) || !track) return;
+    while (sf->next < sf->events.count) {
+        SubEvent* ev = &sf->events.items[sf->next];
+        if (ev->start_ms > ms + SUBFILE_FEED_AHEAD_MS) break;
+        sf->chunk.count = 0;
+        nob_sb_appendf(&sf->chunk, "%d,%s", ev->order, ev->fields);
+        ass_process_chunk(track, sf->chunk.items, (int)sf->chunk.count, ev->start_ms, ev->duration_ms);
+        sf->next++;
+    }
+}
@@ -1,4 +1,5 @@
 #include <string.h>
+#include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -8,18 +9,317 @@
 #include <iconv.h>
 #endif
 #include "../thirdparty/SDL2/SDL_ttf.h"
+#include "config.h"
 
 static TTF_Font* ui_font = NULL;
 static int ui_font_size = 18;
 static char ui_font_label[128] = "Iosevka";
 static char ui_font_path[260] = "";
+static unsigned ui_font_generation = 0;
+
+typedef struct {
+    char* text;
+    uint32_t hash;
+    TTF_Font* font;
+    SDL_Texture* tex;
+    int w;
+    int h;
+    Uint32 last_used;
+} TextCacheEntry;
+
+/* Rendered strings, kept white so one texture serves every colour, alpha and
+ * the drop shadow through colour/alpha modulation. Least recently used
+ * entries are evicted when the table is full. */
+static TextCacheEntry text_cache[TEXT_CACHE_ENTRIES];
+static Uint32 text_cache_clock = 0;
+
+static uint32_t text_hash(const char* text) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void text_cache_drop(TextCacheEntry* e) {
+    if (e->tex) {
+        SDL_DestroyTexture(e->tex);
+        budget_add(BUDGET_UI, -(int64_t)e->w * e->h * 4);
+    }
+    free(e->text);
+    memset(e, 0, sizeof(*e));
+}
+
+static void text_cache_clear(void) {
+    for (int i = 0; i < TEXT_CACHE_ENTRIES; i++) text_cache_drop(&text_cache[i]);
+}
+
+/* Under memory pressure, drops least recently used strings that have not
+ * been drawn in the last quarter of the table's worth of lookups. */
+static void text_cache_trim(void) {
+    while (budget_over()) {
+        TextCacheEntry* victim = NULL;
+        for (int i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+            TextCacheEntry* e = &text_cache[i];
+            if (!e->tex || text_cache_clock - e->last_used < TEXT_CACHE_ENTRIES / 4) continue;
+            if (!victim || e->last_used < victim->last_used) victim = e;
+        }
+        if (!victim) return;
+        text_cache_drop(victim);
+    }
+}
+
+static TextCacheEntry* text_cache_get(SDL_Renderer* ren, const char* text) {
+    uint32_t hash = text_hash(text);
+    TextCacheEntry* victim = &text_cache[0];
+    text_cache_clock++;
+
+    for (int i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+        TextCacheEntry* e = &text_cache[i];
+        if (e->tex && e->hash == hash && e->font == ui_font && strcmp(e->text, text) == 0) {
+            e->last_used = text_cache_clock;
+            return e;
+        }
+        if (!e->tex) victim = e;
+        else if (victim->tex && e->last_used < victim->last_used) victim = e;
+    }
+
+    SDL_Color white = { 255, 255, 255, 255 };
+    SDL_Surface* surf = TTF_RenderUTF8_Blended(ui_font, text, white);
+    if (!surf) return NULL;
+    SDL_Texture* tex = SDL_CreateTextureFromSurface(ren, surf);
+    int w = surf->w, h = surf->h;
+    SDL_FreeSurface(surf);
+    if (!tex) return NULL;
+    SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+
+    text_cache_drop(victim);
+    budget_add(BUDGET_UI, (int64_t)w * h * 4);
+    victim->text = strdup(text);
+    victim->hash = hash;
+    victim->font = ui_font;
+    victim->tex = tex;
+    victim->w = w;
+    victim->h = h;
+    victim->last_used = text_cache_clock;
+    return victim;
+}
+
+typedef struct {
+    Uint32 codepoint;
+    TTF_Font* font;
+    SDL_Rect src;
+    int offset_x;
+    int advance;
+} AtlasGlyph;
+
+/* Glyph atlas: every glyph is rasterised once into a shared texture and text
+ * is queued as textured quads. The queue is submitted with a single
+ * SDL_RenderGeometry call by text_flush(), which must run before anything
+ * that has to appear above the queued text and before presenting. */
+static SDL_Texture* text_atlas = NULL;
+static AtlasGlyph text_atlas_glyphs[TEXT_ATLAS_MAX_GLYPHS];
+static int text_atlas_glyph_count = 0;
+static int text_atlas_x = 0;
+static int text_atlas_y = 0;
+static int text_atlas_row_h = 0;
+static bool text_atlas_failed = false;
+
+static SDL_Vertex* text_batch_verts = NULL;
+static int* text_batch_indices = NULL;
+static int text_batch_quads = 0;
+static int text_batch_capacity = 0;
+
+static void text_atlas_reset(void) {
+    memset(text_atlas_glyphs, 0, sizeof(text_atlas_glyphs));
+    text_atlas_glyph_count = 0;
+    text_atlas_x = 0;
+    text_atlas_y = 0;
+    text_atlas_row_h = 0;
+    text_batch_quads = 0;
+}
+
+static void text_atlas_free(void) {
+    text_atlas_reset();
+    if (text_atlas) {
+        SDL_DestroyTexture(text_atlas);
+        budget_add(BUDGET_UI, -(int64_t)TEXT_ATLAS_SIZE * TEXT_ATLAS_SIZE * 4);
+    }
+    text_atlas = NULL;
+    text_atlas_failed = false;
+    free(text_batch_verts);
+    free(text_batch_indices);
+    text_batch_verts = NULL;
+    text_batch_indices = NULL;
+    text_batch_capacity = 0;
+}
+
+static void text_flush(SDL_Renderer* ren) {
+    if (text_batch_quads == 0 || !text_atlas) return;
+    int ok = SDL_RenderGeometry(ren, text_atlas,
+        text_batch_verts, text_batch_quads * 4,
+        text_batch_indices, text_batch_quads * 6) == 0;
+    text_batch_quads = 0;
+    if (!ok) {
+        /* Renderer without geometry support: fall back to cached strings. */
+        SDL_DestroyTexture(text_atlas);
+        budget_add(BUDGET_UI, -(int64_t)TEXT_ATLAS_SIZE * TEXT_ATLAS_SIZE * 4);
+        text_atlas = NULL;
+        text_atlas_failed = true;
+    }
+}
+
+static Uint32 text_utf8_next(const char** text) {
+    const unsigned char* p = (const unsigned char*)*text;
+    Uint32 cp;
+    int extra;
+    if (p[0] < 0x80) { cp = p[0]; extra = 0; }
+    else if ((p[0] & 0xE0) == 0xC0) { cp = p[0] & 0x1F; extra = 1; }
+    else if ((p[0] & 0xF0) == 0xE0) { cp = p[0] & 0x0F; extra = 2; }
+    else if ((p[0] & 0xF8) == 0xF0) { cp = p[0] & 0x07; extra = 3; }
+    else { *text += 1; return 0xFFFD; }
+    for (int i = 1; i <= extra; i++) {
+        if ((p[i] & 0xC0) != 0x80) { *text += i; return 0xFFFD; }
+        cp = (cp << 6) | (p[i] & 0x3F);
+    }
+    *text += extra + 1;
+    return cp;
+}
+
+static AtlasGlyph* text_atlas_slot(Uint32 cp) {
+    Uint32 mask = TEXT_ATLAS_MAX_GLYPHS - 1;
+    Uint32 i = (cp * 2654435761u) & mask;
+    while (text_atlas_glyphs[i].font && text_atlas_glyphs[i].codepoint != cp) i = (i + 1) & mask;
+    return &text_atlas_glyphs[i];
+}
+
+static AtlasGlyph* text_atlas_glyph(SDL_Renderer* ren, Uint32 cp) {
+    AtlasGlyph* g = text_atlas_slot(cp);
+    if (g->font) return g;
+
+    int minx = 0, maxx = 0, miny = 0, maxy = 0, advance = 0;
+    if (TTF_GlyphMetrics32(ui_font, cp, &minx, &maxx, &miny, &maxy, &advance) != 0) return NULL;
+
+    SDL_Surface* surf = NULL;
+    if (maxx > minx) {
+        SDL_Color white = { 255, 255, 255, 255 };
+        SDL_Surface* rendered = TTF_RenderGlyph32_Blended(ui_font, cp, white);
+        if (!rendered) return NULL;
+        surf = SDL_ConvertSurfaceFormat(rendered, SDL_PIXELFORMAT_ARGB8888, 0);
+        SDL_FreeSurface(rendered);
+        if (!surf) return NULL;
+    }
+
+    int gw = surf ? surf->w : 0;
+    int gh = surf ? surf->h : 0;
+    if (gw + 1 > TEXT_ATLAS_SIZE || gh + 1 > TEXT_ATLAS_SIZE) { SDL_FreeSurface(surf); return NULL; }
+
+    if (text_atlas_x + gw + 1 > TEXT_ATLAS_SIZE) {
+        text_atlas_x = 0;
+        text_atlas_y += text_atlas_row_h;
+        text_atlas_row_h = 0;
+    }
+    if (text_atlas_y + gh + 1 > TEXT_ATLAS_SIZE
+        || text_atlas_glyph_count + 1 > TEXT_ATLAS_MAX_GLYPHS * 3 / 4) {
+        text_flush(ren);
+        text_atlas_reset();
+        g = text_atlas_slot(cp);
+    }
+
+    g->codepoint = cp;
+    g->font = ui_font;
+    g->src = (SDL_Rect){ text_atlas_x, text_atlas_y, gw, gh };
+    g->offset_x = minx < 0 ? minx : 0;
+    g->advance = advance;
+    if (surf) {
+        SDL_UpdateTexture(text_atlas, &g->src, surf->pixels, surf->pitch);
+        SDL_FreeSurface(surf);
+    }
+    text_atlas_x += gw + 1;
+    if (gh + 1 > text_atlas_row_h) text_atlas_row_h = gh + 1;
+    text_atlas_glyph_count++;
+    return g;
+}
+
+static bool text_atlas_ensure(SDL_Renderer* ren) {
+    if (text_atlas) return true;
+    if (text_atlas_failed) return false;
+    text_atlas = SDL_CreateTexture(ren, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
+                                   TEXT_ATLAS_SIZE, TEXT_ATLAS_SIZE);
+    if (!text_atlas) { text_atlas_failed = true; return false; }
+    budget_add(BUDGET_UI, (int64_t)TEXT_ATLAS_SIZE * TEXT_ATLAS_SIZE * 4);
+    SDL_SetTextureBlendMode(text_atlas, SDL_BLENDMODE_BLEND);
+    SDL_SetTextureScaleMode(text_atlas, SDL_ScaleModeNearest);
+    text_atlas_reset();
+    return true;
+}
+
+static void text_batch_quad(const AtlasGlyph* g, float x, float y, SDL_Color color) {
+    if (text_batch_quads == text_batch_capacity) {
+        int cap = text_batch_capacity ? text_batch_capacity * 2 : 256;
+        SDL_Vertex* verts = (SDL_Vertex*)realloc(text_batch_verts, sizeof(SDL_Vertex) * 4 * cap);
+        if (!verts) return;
+        text_batch_verts = verts;
+        int* indices = (int*)realloc(text_batch_indices, sizeof(int) * 6 * cap);
+        if (!indices) return;
+        text_batch_indices = indices;
+        text_batch_capacity = cap;
+    }
+
+    float u0 = (float)g->src.x / TEXT_ATLAS_SIZE;
+    float v0 = (float)g->src.y / TEXT_ATLAS_SIZE;
+    float u1 = (float)(g->src.x + g->src.w) / TEXT_ATLAS_SIZE;
+    float v1 = (float)(g->src.y + g->src.h) / TEXT_ATLAS_SIZE;
+    float x1 = x + g->src.w;
+    float y1 = y + g->src.h;
+
+    SDL_Vertex* v = &text_batch_verts[text_batch_quads * 4];
+    v[0] = (SDL_Vertex){ { x,  y  }, color, { u0, v0 } };
+    v[1] = (SDL_Vertex){ { x1, y  }, color, { u1, v0 } };
+    v[2] = (SDL_Vertex){ { x1, y1 }, color, { u1, v1 } };
+    v[3] = (SDL_Vertex){ { x,  y1 }, color, { u0, v1 } };
+
+    int base = text_batch_quads * 4;
+    int* idx = &text_batch_indices[text_batch_quads * 6];
+    idx[0] = base; idx[1] = base + 1; idx[2] = base + 2;
+    idx[3] = base; idx[4] = base + 2; idx[5] = base + 3;
+    text_batch_quads++;
+}
+
+/* Queues `text` through the atlas. Returns false if some glyph could not be
+ * placed, in which case nothing is queued. */
+static bool text_atlas_draw(SDL_Renderer* ren, int x, int y, const char* text, SDL_Color color) {
+    if (!text_atlas_ensure(ren)) return false;
+
+    for (const char* p = text; *p;) {
+        if (!text_atlas_glyph(ren, text_utf8_next(&p))) return false;
+    }
+
+    int start_quads = text_batch_quads;
+    float pen = (float)x;
+    Uint32 prev = 0;
+    for (const char* p = text; *p;) {
+        Uint32 cp = text_utf8_next(&p);
+        AtlasGlyph* g = text_atlas_slot(cp);
+        if (!g->font) { text_batch_quads = start_quads; return false; }
+        if (prev) pen += (float)TTF_GetFontKerningSizeGlyphs32(ui_font, prev, cp);
+        if (g->src.w > 0) text_batch_quad(g, pen + g->offset_x, (float)y, color);
+        pen += (float)g->advance;
+        prev = cp;
+    }
+    return true;
+}
 
 static bool load_ui_font(const char* path, const char* label) {
     if (!path || !path[0]) return false;
     TTF_Font* font = TTF_OpenFont(path, ui_font_size);
     if (!font) return false;
+    text_cache_clear();
+    text_atlas_reset();
     if (ui_font) TTF_CloseFont(ui_font);
     ui_font = font;
+    ui_font_generation++;
     strncpy(ui_font_path, path, sizeof(ui_font_path) - 1);
     ui_font_path[sizeof(ui_font_path) - 1] = '\0';
     if (label) {
@@ -34,16 +334,20 @@ static const char* try_load_ui_font(const char* path, const char* label) {
     return SDL_GetError();
 }
 
+static void draw_text_cached(SDL_Renderer* ren, int x, int y, const char* text, SDL_Color color) {
+    TextCacheEntry* e = text_cache_get(ren, text);
+    if (!e) return;
+    SDL_Rect dst = { x, y, e->w, e->h };
+    SDL_SetTextureColorMod(e->tex, color.r, color.g, color.b);
+    SDL_SetTextureAlphaMod(e->tex, color.a);
+    SDL_RenderCopy(ren, e->tex, NULL, &dst);
+}
+
 static void draw_text(SDL_Renderer* ren, int x, int y, const char* text, SDL_Color color) {
-    if (!text || !ui_font) return;
-    SDL_Surface* surf = TTF_RenderUTF8_Blended(ui_font, text, color);
-    if (!surf) return;
-    SDL_Texture* tex = SDL_CreateTextureFromSurface(ren, surf);
-    if (!tex) { SDL_FreeSurface(surf); return; }
-    SDL_Rect dst = { x, y, surf->w, surf->h };
-    SDL_FreeSurface(surf);
-    SDL_RenderCopy(ren, tex, NULL, &dst);
-    SDL_DestroyTexture(tex);
+    if (!text || !text[0] || !ui_font) return;
+    if (text_atlas_draw(ren, x, y, text, color)) return;
+    text_flush(ren);
+    draw_text_cached(ren, x, y, text, color);
 }
 
 static void draw_text_shadow(SDL_Renderer* ren, int x, int y, const char* text, SDL_Color color) {
@@ -91,8 +395,8 @@ const char* subtitle_normalize_to_utf8(
     size_t size = strlen(text);
 
     size_t wchar_count = size/2;
-    wchar_t tmp[1024];
-    if (wchar_count >= 1023) wchar_count = 1023;
+    wchar_t* tmp = (wchar_t*)malloc((wchar_count + 1) * sizeof(wchar_t));
+    if (!tmp) return text;
 
     for(size_t i = 0; i < wchar_count; i++){
         uint16_t v = is_utf16be
@@ -106,6 +410,7 @@ const char* subtitle_normalize_to_utf8(
     if(start[0] == 0xFEFF) start++;
 
     int needed = WideCharToMultiByte(CP_UTF8, 0, start, -1, outbuf, (int)outbuf_size, NULL, NULL);
+    free(tmp);
     if(needed > 0) return outbuf;
 
     return text;
@@ -0,0 +1,321 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../thirdparty/nob.h"
+#include "../thirdparty/SDL2/SDL.h"
+#include "../thirdparty/libavformat/avformat.h"
+#include "../thirdparty/libavcodec/avcodec.h"
+#include "../thirdparty/libswscale/swscale.h"
+
+#define THUMB_WIDTH 160
+#define THUMB_BUCKET_SEC 2.0
+#define THUMB_CACHE_SLOTS 96
+#define THUMB_MAX_PACKETS 2048 /* give up on a bucket after this many reads */
+
+typedef struct {
+    int64_t bucket;     /* -1 when the slot is free */
+    uint64_t last_used;
+    int w, h;
+    uint8_t* pixels;    /* RGBA32, NULL when the decode failed */
+} ThumbEntry;
+
+/* Timeline previews from a private demuxer and decoder on a low-priority
+ * thread. Only keyframes are decoded, at reduced resolution where the codec
+ * allows, and kept in a small LRU keyed by time bucket. The UI asks for one
+ * bucket at a time; a newer request replaces an older one that has not
+ * started. */
+typedef struct {
+    SDL_Thread* thread;
+    SDL_mutex* lock;
+    SDL_cond* cond;
+    char* path;
+    int stream_index;
+    int quit;
+    int failed;
+    int paused;         /* window hidden: no background storyboard fill */
+    int64_t wanted;     /* bucket the UI is waiting for, -1 for none */
+    uint64_t tick;
+    ThumbEntry entries[THUMB_CACHE_SLOTS];
+    SDL_atomic_t decodes;
+    /* storyboard outcome for the stats overlay */
+    SDL_atomic_t storyboard_tiles;   /* tiles on disk */
+    SDL_atomic_t storyboard_count;   /* tiles in the storyboard, 0 when there is none */
+    SDL_atomic_t storyboard_evicted; /* older storyboards deleted when it opened */
+} ThumbWorker;
+
+static int64_t thumb_bucket(double seconds) {
+    return seconds > 0.0 ? (int64_t)(seconds / THUMB_BUCKET_SEC) : 0;
+}
+
+static int thumb_find_locked(ThumbWorker* tw, int64_t bucket) {
+    for (int i = 0; i < THUMB_CACHE_SLOTS; i++) {
+        if (tw->entries[i].bucket == bucket) return i;
+    }
+    return -1;
+}
+
+static void thumb_store_locked(ThumbWorker* tw, int64_t bucket, uint8_t* pixels, int w, int h) {
+    int slot = 0;
+    for (int i = 0; i < THUMB_CACHE_SLOTS; i++) {
+        if (tw->entries[i].bucket < 0) { slot = i; break; }
+        if (tw->entries[i].last_used < tw->entries[slot].last_used) slot = i;
+    }
+    ThumbEntry* e = &tw->entries[slot];
+    if (e->pixels) {
+        budget_add(BUDGET_UI, -(int64_t)e->w * e->h * 4);
+        free(e->pixels);
+    }
+    e->bucket = bucket;
+    e->last_used = ++tw->tick;
+    e->pixels = pixels;
+    e->w = w;
+    e->h = h;
+    if (pixels) budget_add(BUDGET_UI, (int64_t)w * h * 4);
+}
+
+static AVCodecContext* thumb_open_decoder(AVStream* st) {
+    const AVCodec* codec = avcodec_find_decoder(st->codecpar->codec_id);
+    if (!codec) return NULL;
+    AVCodecContext* ctx = avcodec_alloc_context3(codec);
+    if (!ctx) return NULL;
+    avcodec_parameters_to_context(ctx, st->codecpar);
+    ctx->thread_count = 1;
+    ctx->skip_frame = AVDISCARD_NONKEY;
+    ctx->skip_loop_filter = AVDISCARD_ALL;
+    ctx->flags2 |= AV_CODEC_FLAG2_FAST;
+    int lowres = 0;
+    while (lowres < codec->max_lowres && (st->codecpar->width >> (lowres + 1)) >= THUMB_WIDTH) lowres++;
+    ctx->lowres = lowres;
+    if (avcodec_open2(ctx, codec, NULL) < 0) {
+        avcodec_free_context(&ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+/* Thumbnail size for the stream, THUMB_WIDTH wide at its display aspect. */
+static void thumb_size(const AVStream* st, int* w, int* h) {
+    const AVCodecParameters* par = st->codecpar;
+    double aspect = par->height > 0 ? (double)par->width / (double)par->height : 16.0 / 9.0;
+    if (par->sample_aspect_ratio.num > 0) aspect *= av_q2d(par->sample_aspect_ratio);
+    *w = THUMB_WIDTH;
+    *h = ((int)(THUMB_WIDTH / aspect) + 1) & ~1;
+    if (*h < 2) *h = 2;
+    if (*h > THUMB_WIDTH * 4) *h = THUMB_WIDTH * 4;
+}
+
+/* Seeks to the keyframe at or before the middle of `bucket`, decodes it alone
+ * and scales it into `rgba`. */
+static int thumb_decode(AVFormatContext* fmt, AVCodecContext* ctx, AVStream* st, AVFrame* frame,
+                        struct SwsContext** sws, int64_t bucket, uint8_t* rgba, int w, int h) {
+    int64_t start = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+    double t = ((double)bucket + 0.5) * THUMB_BUCKET_SEC;
+    int64_t ts = start + av_rescale_q((int64_t)(t * AV_TIME_BASE), AV_TIME_BASE_Q, st->time_base);
+    if (av_seek_frame(fmt, st->index, ts, AVSEEK_FLAG_BACKWARD) < 0) return 0;
+    avcodec_flush_buffers(ctx);
+
+    AVPacket* pkt = av_packet_alloc();
+    int got = 0;
+    for (int reads = 0; pkt && !got && reads < THUMB_MAX_PACKETS && av_read_frame(fmt, pkt) >= 0; reads++) {
+        if (pkt->stream_index == st->index && (pkt->flags & AV_PKT_FLAG_KEY)
+            && avcodec_send_packet(ctx, pkt) >= 0) {
+            /* drain so a decoder with reorder delay hands the keyframe back now */
+            avcodec_send_packet(ctx, NULL);
+            got = avcodec_receive_frame(ctx, frame) == 0;
+            avcodec_flush_buffers(ctx);
+        }
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+    if (!got || frame->width <= 0 || frame->height <= 0) {
+        av_frame_unref(frame);
+        return 0;
+    }
+
+    *sws = sws_getCachedContext(*sws, frame->width, frame->height, frame->format,
+                                w, h, AV_PIX_FMT_RGBA, SWS_BILINEAR, NULL, NULL, NULL);
+    if (*sws) {
+        uint8_t* dst[4] = { rgba, NULL, NULL, NULL };
+        int stride[4] = { w * 4, 0, 0, 0 };
+        sws_scale(*sws, (const uint8_t* const*)frame->data, frame->linesize, 0, frame->height, dst, stride);
+    }
+    av_frame_unref(frame);
+    return *sws != NULL;
+}
+
+/* The on-disk storyboard uses the thumbnail buckets as its intervals. */
+static Storyboard* thumb_open_storyboard(ThumbWorker* tw, AVFormatContext* fmt, int w, int h) {
+    if (fmt->duration == AV_NOPTS_VALUE || fmt->duration <= 0) return NULL;
+    uint64_t fingerprint;
+    if (!storyboard_fingerprint(tw->path, &fingerprint)) return NULL;
+    fingerprint ^= (uint64_t)tw->stream_index * 0x9E3779B97F4A7C15ULL;
+    int64_t count = thumb_bucket((double)fmt->duration / AV_TIME_BASE) + 1;
+    Storyboard* sb = storyboard_open(fingerprint, THUMB_BUCKET_SEC, w, h, count);
+    if (sb) {
+        SDL_AtomicSet(&tw->storyboard_count, (int)count);
+        SDL_AtomicSet(&tw->storyboard_tiles, (int)sb->present);
+        SDL_AtomicSet(&tw->storyboard_evicted, sb->evicted);
+    }
+    return sb;
+}
+
+static int SDLCALL thumb_worker_run(void* userdata) {
+    ThumbWorker* tw = (ThumbWorker*)userdata;
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);
+
+    AVFormatContext* fmt = NULL;
+    AVCodecContext* ctx = NULL;
+    if (avformat_open_input(&fmt, tw->path, NULL, NULL) == 0 && tw->stream_index < (int)fmt->nb_streams) {
+        for (unsigned i = 0; i < fmt->nb_streams; i++) {
+            if ((int)i != tw->stream_index) fmt->streams[i]->discard = AVDISCARD_ALL;
+        }
+        ctx = thumb_open_decoder(fmt->streams[tw->stream_index]);
+    }
+    AVFrame* frame = av_frame_alloc();
+    struct SwsContext* sws = NULL;
+    Storyboard* sb = NULL;
+    int w = 0, h = 0;
+    if (ctx && frame) {
+        thumb_size(fmt->streams[tw->stream_index], &w, &h);
+        sb = thumb_open_storyboard(tw, fmt, w, h);
+    }
+
+    SDL_LockMutex(tw->lock);
+    if (!ctx || !frame) tw->failed = 1; /* reported by the stats overlay */
+    while (!tw->failed) {
+        /* the bucket under the pointer first, then the storyboard's gaps */
+        int64_t bucket = -1;
+        int background = 0;
+        while (!tw->quit) {
+            if (tw->wanted >= 0 && thumb_find_locked(tw, tw->wanted) < 0) {
+                bucket = tw->wanted;
+                break;
+            }
+            if (sb && !tw->paused && (bucket = storyboard_next_missing(sb)) >= 0) {
+                background = 1;
+                break;
+            }
+            SDL_CondWait(tw->cond, tw->lock);
+        }
+        if (tw->quit) break;
+        SDL_UnlockMutex(tw->lock);
+
+        uint8_t* pixels = (uint8_t*)malloc((size_t)w * h * 4);
+        int got = pixels && sb ? storyboard_get(sb, bucket, pixels) : 0;
+        if (pixels && got == 0) {
+            got = thumb_decode(fmt, ctx, fmt->streams[tw->stream_index], frame, &sws, bucket, pixels, w, h) ? 1 : -1;
+            SDL_AtomicAdd(&tw->decodes, 1);
+            if (sb) {
+                storyboard_put(sb, bucket, got > 0 ? pixels : NULL);
+                SDL_AtomicSet(&tw->storyboard_tiles, (int)sb->present);
+            }
+        }
+        if (got <= 0 || background) {
+            free(pixels);
+            pixels = NULL;
+        }
+
+        SDL_LockMutex(tw->lock);
+        if (!background) thumb_store_locked(tw, bucket, pixels, w, h);
+    }
+    SDL_UnlockMutex(tw->lock);
+
+    storyboard_close(sb);
+    sws_freeContext(sws);
+    av_frame_free(&frame);
+    avcodec_free_context(&ctx);
+    if (fmt) avformat_close_input(&fmt);
+    return 0;
+}
+
+static ThumbWorker* thumb_worker_start(const char* path, int stream_index) {
+    ThumbWorker* tw = (ThumbWorker*)calloc(1, sizeof(ThumbWorker));
+    if (!tw) return NULL;
+    for (int i = 0; i < THUMB_CACHE_SLOTS; i++) tw->entries[i].bucket = -1;
+    tw->wanted = -1;
+    tw->path = strdup(path);
+    tw->stream_index = stream_index;
+    tw->lock = SDL_CreateMutex();
+    tw->cond = SDL_CreateCond();
+    if (tw->path && tw->lock && tw->cond) tw->thread = SDL_CreateThread(thumb_worker_run, "amp-thumbs", tw);
+    if (!tw->thread) {
+        nob_log(NOB_WARNING, "Failed to start thumbnail worker: %s", SDL_GetError());
+        if (tw->cond) SDL_DestroyCond(tw->cond);
+        if (tw->lock) SDL_DestroyMutex(tw->lock);
+        free(tw->path);
+        free(tw);
+        return NULL;
+    }
+    return tw;
+}
+
+static int thumb_worker_failed(ThumbWorker* tw) {
+    SDL_LockMutex(tw->lock);
+    int failed = tw->failed;
+    SDL_UnlockMutex(tw->lock);
+    return failed;
+}
+
+/* Stops or resumes the storyboard fill; requested thumbnails still decode. */
+static void thumb_worker_set_paused(ThumbWorker* tw, int paused) {
+    if (!tw) return;
+    SDL_LockMutex(tw->lock);
+    tw->paused = paused;
+    SDL_CondBroadcast(tw->cond);
+    SDL_UnlockMutex(tw->lock);
+}
+
+static void thumb_worker_free(ThumbWorker* tw) {
+    if (!tw) return;
+    SDL_LockMutex(tw->lock);
+    tw->quit = 1;
+    SDL_CondBroadcast(tw->cond);
+    SDL_UnlockMutex(tw->lock);
+    SDL_WaitThread(tw->thread, NULL);
+    for (int i = 0; i < THUMB_CACHE_SLOTS; i++) {
+        if (tw->entries[i].pixels) budget_add(BUDGET_UI, -(int64_t)tw->entries[i].w * tw->entries[i].h * 4);
+        free(tw->entries[i].pixels);
+    }
+    SDL_DestroyCond(tw->cond);
+    SDL_DestroyMutex(tw->lock);
+    free(tw->path);
+    free(tw);
+}
+
+/* Uploads the thumbnail for `seconds` into *tex, recreating it when the size
+ * changes, and returns its height. Returns 0 and queues the bucket when it is
+ * not cached yet, or -1 when it never will be. */
+static int thumb_fetch(ThumbWorker* tw, double seconds, SDL_Renderer* ren, SDL_Texture** tex, int64_t* tex_bucket) {
+    if (!tw) return -1;
+    int64_t bucket = thumb_bucket(seconds);
+    SDL_LockMutex(tw->lock);
+    if (tw->failed) {
+        SDL_UnlockMutex(tw->lock);
+        return -1;
+    }
+    int slot = thumb_find_locked(tw, bucket);
+    if (slot < 0) {
+        if (tw->wanted != bucket) {
+            tw->wanted = bucket;
+            SDL_CondSignal(tw->cond);
+        }
+        SDL_UnlockMutex(tw->lock);
+        return 0;
+    }
+    ThumbEntry* e = &tw->entries[slot];
+    e->last_used = ++tw->tick;
+    int h = e->pixels ? e->h : -1;
+    if (e->pixels && *tex_bucket != bucket) {
+        int tw_w = 0, tw_h = 0;
+        if (*tex) SDL_QueryTexture(*tex, NULL, NULL, &tw_w, &tw_h);
+        if (!*tex || tw_w != e->w || tw_h != e->h) {
+            if (*tex) SDL_DestroyTexture(*tex);
+            *tex = SDL_CreateTexture(ren, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, e->w, e->h);
+        }
+        if (*tex) SDL_UpdateTexture(*tex, NULL, e->pixels, e->w * 4);
+        *tex_bucket = *tex ? bucket : -1;
+        if (!*tex) h = -1;
+    }
+    SDL_UnlockMutex(tw->lock);
+    return h;
+}